@@ -0,0 +1,177 @@
+#include "BinarySearchTree.h"
+#include "BTreeSet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+// Сравнение пропускной способности BinarySearchTree (AVL), BTreeSet и FrozenBinarySearchTree на поиске, ранге и полном проходе,
+// скорости записи в файл и загрузки из него, а также вставки с подсказкой и удаления по итератору.
+// Размер задается первым аргументом; собирать с -DCMAKE_BUILD_TYPE=Release
+
+template<typename Function>
+double measure(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void report(const std::string &name, size_t operations, double seconds) {
+    std::cout << name << ": " << operations / seconds / 1e6 << " Mops/s" << std::endl;
+}
+
+template<typename Tree>
+void run(const std::string &name, Tree &tree, const std::vector<int> &values, const std::vector<int> &queries) {
+    double seconds = measure([&]() {
+        for (int value : values) {
+            tree.add(value);
+        }
+    });
+    report(name + " add", values.size(), seconds);
+
+    size_t found = 0;
+    seconds = measure([&]() {
+        for (int query : queries) {
+            found += tree.contains(query);
+        }
+    });
+    report(name + " contains", queries.size(), seconds);
+
+    size_t ranks = 0;
+    seconds = measure([&]() {
+        for (int query : queries) {
+            ranks += tree.rank(query);
+        }
+    });
+    report(name + " rank", queries.size(), seconds);
+
+    long long sum = 0;
+    seconds = measure([&]() {
+        for (auto it = tree.begin(), end = tree.end(); it != end; ++it) {
+            sum += *it;
+        }
+    });
+    report(name + " scan", tree.size(), seconds);
+
+    seconds = measure([&]() {
+        for (int value : values) {
+            tree.remove(value);
+        }
+    });
+    report(name + " remove", values.size(), seconds);
+
+    // вывод результатов не дает компилятору выбросить измеряемые циклы
+    std::cout << name << " checksum: " << found << " " << ranks << " " << sum << std::endl;
+}
+
+template<typename Tree>
+void runFrozen(const std::string &name, const Tree &tree, const std::vector<int> &queries) {
+    size_t found = 0;
+    double seconds = measure([&]() {
+        for (int query : queries) {
+            found += tree.contains(query);
+        }
+    });
+    report(name + " contains", queries.size(), seconds);
+
+    long long sum = 0;
+    seconds = measure([&]() {
+        for (auto it = tree.iteratorBegin(); !it.isEnd(); it.next()) {
+            sum += it.value();
+        }
+    });
+    report(name + " scan", tree.size(), seconds);
+    std::cout << name << " checksum: " << found << " " << sum << std::endl;
+}
+
+// Функция сравнения, считающая свои вызовы
+struct CountingLess {
+    static size_t calls;
+
+    bool operator()(int a, int b) const {
+        calls++;
+        return a < b;
+    }
+};
+
+size_t CountingLess::calls = 0;
+
+// Скользящее окно: добавляется новейший элемент, удаляется старейший.
+// Подсказка и удаление по итератору экономят только вызовы функции сравнения: размеры веток и высоты
+// по-прежнему пересчитываются до корня, поэтому с дешевым сравнением int скорость почти не меняется
+template<typename Step>
+void runWindow(const std::string &name, size_t operations, Step step) {
+    CountingLess::calls = 0;
+    double seconds = measure([&]() {
+        for (size_t i = 0; i < operations; i++) {
+            step((int) i);
+        }
+    });
+    report(name, operations, seconds);
+    std::cout << name << " comparisons per step: " << (double) CountingLess::calls / operations << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937 random(2024);
+    std::vector<int> values(size);
+    std::iota(values.begin(), values.end(), 0);
+    std::shuffle(values.begin(), values.end(), random);
+    std::vector<int> queries(size);
+    std::uniform_int_distribution<int> distribution(0, static_cast<int>(size) * 2);
+    for (int &query : queries) {
+        query = distribution(random); // примерно половина запросов находит элемент
+    }
+
+    BinarySearchTree<int> binary_tree(IN_ORDER, std::less<int>(), AVL);
+    run("BinarySearchTree", binary_tree, values, queries);
+
+    BTreeSet<int> b_tree(IN_ORDER);
+    run("BTreeSet", b_tree, values, queries);
+
+    auto built_tree = BinarySearchTree<int>::fromUnsorted(values.begin(), values.end(), IN_ORDER,
+                                                          std::less<int>(), AVL);
+    auto frozen_tree = built_tree.freeze();
+    runFrozen("FrozenBinarySearchTree", frozen_tree, queries);
+    std::cout << "memory per element: BinarySearchTree " << sizeof(BSTNode<int>)
+              << " B, FrozenBinarySearchTree " << sizeof(int) << " B" << std::endl;
+
+    const std::string sorted_path = "benchmark_sorted.bin";
+    const std::string frozen_path = "benchmark_frozen.bin";
+    report("BinarySearchTree save", size, measure([&]() { built_tree.save(sorted_path); }));
+    report("BinarySearchTree load", size, measure([&]() {
+        built_tree = BinarySearchTree<int>::load(sorted_path, IN_ORDER, std::less<int>(), AVL);
+    }));
+    report("FrozenBinarySearchTree save", size, measure([&]() { frozen_tree.save(frozen_path); }));
+    report("FrozenBinarySearchTree map", size, measure([&]() {
+        frozen_tree = FrozenBinarySearchTree<int>::map(frozen_path);
+    }));
+    runFrozen("mapped FrozenBinarySearchTree", frozen_tree, queries);
+    std::remove(sorted_path.c_str());
+    std::remove(frozen_path.c_str());
+
+    const int window = 1000;
+    BinarySearchTree<int, CountingLess> window_tree(IN_ORDER, CountingLess(), AVL);
+    runWindow("window add/remove", size, [&](int i) {
+        window_tree.add(i);
+        if (i >= window) {
+            window_tree.remove(i - window);
+        }
+    });
+    window_tree.clear();
+    runWindow("window insert(hint)/erase(iterator)", size, [&](int i) {
+        window_tree.insert(window_tree.end(), i);
+        if (i >= window) {
+            window_tree.erase(window_tree.begin());
+        }
+    });
+    return 0;
+}
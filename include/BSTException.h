@@ -43,4 +43,31 @@ public:
             : BSTException("BSTEmptyException: " + msg) {}
 };
 
+class BSTUnsortedValuesException : public BSTException {
+public:
+    BSTUnsortedValuesException()
+            : BSTException() {}
+
+    explicit BSTUnsortedValuesException(const std::string &msg)
+            : BSTException("BSTUnsortedValuesException: " + msg) {}
+};
+
+class BSTOutOfRangeException : public BSTException {
+public:
+    BSTOutOfRangeException()
+            : BSTException() {}
+
+    explicit BSTOutOfRangeException(const std::string &msg)
+            : BSTException("BSTOutOfRangeException: " + msg) {}
+};
+
+class BSTFileException : public BSTException {
+public:
+    BSTFileException()
+            : BSTException() {}
+
+    explicit BSTFileException(const std::string &msg)
+            : BSTException("BSTFileException: " + msg) {}
+};
+
 #endif //CONTAINER_BSTEXCEPTION_H
@@ -0,0 +1,77 @@
+#ifndef CONTAINER_BSTFILE_H
+#define CONTAINER_BSTFILE_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include "BSTException.h"
+
+// Порядок элементов в файле
+enum file_layout : uint32_t {
+    SORTED_LAYOUT = 1, // по возрастанию (BinarySearchTree::save)
+    EYTZINGER_LAYOUT = 2 // ячейки FrozenBinarySearchTree (FrozenBinarySearchTree::save)
+};
+
+// Заголовок файла дерева; занимает 64 байта, поэтому элементы после него выровнены
+// для любого типа с выравниванием до 64 байт
+struct BSTFileHeader {
+    char magic[8]; // "BSTFILE"
+    uint32_t version;
+    uint32_t byte_order; // 0x01020304 в порядке байт записавшей машины
+    uint32_t layout;
+    uint32_t element_size; // sizeof(T)
+    uint64_t count; // количество элементов
+    uint8_t reserved[32];
+};
+
+// Запись и чтение элементов: по умолчанию байты элементов копируются как есть,
+// для типов, которые нельзя копировать побайтово, нужна специализация с теми же методами
+template<typename T>
+struct BSTSerializer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "BSTSerializer must be specialized for types that are not trivially copyable");
+
+    static void write(std::ostream &os, const T *arr, size_t size);
+//    Записать size элементов массива в поток
+
+    static void read(std::istream &is, T *arr, size_t size);
+//    Прочитать size элементов из потока в массив
+};
+
+class BSTFile {
+public:
+    static void checkHeader(const BSTFileHeader &header, file_layout layout, size_t element_size);
+//    Проверить заголовок прочитанного файла (BSTFileException, если файл не подходит)
+
+    static BSTFileHeader makeHeader(file_layout layout, size_t element_size, size_t count);
+//    Заголовок нового файла
+
+    static std::shared_ptr<const char> map(const std::string &path, size_t &length);
+//    Отобразить файл в память только для чтения (без mmap файл читается целиком), length - длина файла
+
+    static void readHeader(std::istream &is, BSTFileHeader &header);
+//    Прочитать заголовок из потока
+
+    static void writeHeader(std::ostream &os, const BSTFileHeader &header);
+//    Записать заголовок в поток
+
+    static constexpr size_t batch_size = 4096;
+//    Количество элементов, записываемых или читаемых за раз
+};
+
+
+template<typename T>
+void BSTSerializer<T>::write(std::ostream &os, const T *arr, size_t size) {
+    os.write(reinterpret_cast<const char *>(arr), static_cast<std::streamsize>(sizeof(T) * size));
+}
+
+template<typename T>
+void BSTSerializer<T>::read(std::istream &is, T *arr, size_t size) {
+    is.read(reinterpret_cast<char *>(arr), static_cast<std::streamsize>(sizeof(T) * size));
+}
+
+#endif //CONTAINER_BSTFILE_H
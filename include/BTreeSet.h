@@ -0,0 +1,1423 @@
+#ifndef CONTAINER_BTREE_SET_H
+#define CONTAINER_BTREE_SET_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "BinarySearchTree.h"
+
+template<typename T>
+class BTreeIterator;
+
+template<typename T, typename Compare = std::less<T>>
+class BTreeSet;
+
+// Узел хранит упорядоченные ключи подряд; емкость подобрана так, чтобы ключи занимали около 256 байт
+// (несколько соседних кэш-линий), поэтому поиск внутри узла не требует переходов по указателям
+template<typename T>
+struct BTreeNode {
+    static constexpr size_t degree = std::max<size_t>(2, (256 / sizeof(T) + 1) / 2);
+    static constexpr size_t capacity = degree * 2 - 1;
+
+    BTreeNode<T> *parent; // root->parent == nullptr
+    size_t index; // позиция среди потомков родителя
+    size_t size; // количество ключей
+    size_t count; // количество ключей во всей ветке
+    bool leaf;
+    T keys[capacity];
+};
+
+template<typename T>
+struct BTreeInnerNode : BTreeNode<T> {
+    BTreeNode<T> *children[BTreeNode<T>::capacity + 1];
+};
+
+// B-дерево с основной частью интерфейса BinarySearchTree (без политики балансировки: B-дерево
+// всегда сбалансировано). PRE_ORDER и POST_ORDER проходят узлы: ключи узла перед (после) его ветками.
+// Узлы хранят количество ключей в ветке, поэтому nth, rank и countRange работают за O(log n)
+template<typename T, typename Compare>
+class BTreeSet {
+public:
+    explicit BTreeSet(tree_order order = IN_ORDER, Compare comparator = Compare());
+//    Конструктор по умолчанию
+
+    BTreeSet(const BTreeSet<T, Compare> &obj);
+//    Конструктор копирования
+
+    BTreeSet(BTreeSet<T, Compare> &&obj) noexcept;
+//    Конструктор переноса (за O(1), obj становится пустым)
+
+    BTreeSet(std::initializer_list<T> &lst, tree_order order = IN_ORDER, Compare comparator = Compare());
+//    Конструктор с инициализацией списком
+
+    ~BTreeSet() noexcept;
+//    Деструктор
+
+    void add(const T &elem);
+//    Добавить элемент
+
+    void addMany(const T *arr, size_t size);
+//    Добавить массив элементов
+
+    BTreeIterator<T> begin() const;
+//    Получить итератор на первый элемент
+
+    void clear();
+//    Удалить все элементы
+
+    bool contains(const T &elem) const;
+//    Проверить имеется ли указанный элемент в дереве
+
+    bool contains(const BTreeSet<T, Compare> &obj) const;
+//    Проверить содержатся ли все элементы другого дерева в данном
+
+    void copy(const BTreeSet<T, Compare> &obj);
+//    Скопировать другое дерево
+
+    size_t countRange(const T &from, const T &to) const;
+//    Количество элементов в полуинтервале [from, to) за O(log n)
+
+    BTreeIterator<T> end() const;
+//    Получить итератор на фиктивный элемент, следующий за последним
+
+    size_t erase(const T &elem);
+//    Удалить элемент, если он есть (возвращает количество удаленных: 0 или 1)
+
+    void extend(const BTreeSet<T, Compare> &obj);
+//    Добавить элементы другого дерева (имеющиеся пропускаются)
+
+    BTreeIterator<T> find(const T &elem) const;
+//    Итератор по возрастанию на элемент (или на фиктивный элемент, если его нет)
+
+    template<typename Visitor>
+    void forEachInRange(const T &from, const T &to, Visitor visitor) const;
+//    Посетить по возрастанию элементы полуинтервала [from, to)
+
+    std::pair<BTreeIterator<T>, bool> insert(const T &elem);
+//    Добавить элемент, если его еще нет (итератор по возрастанию на элемент и признак добавления)
+
+    bool isEmpty() const;
+//    Проверить является ли дерево пустым
+
+    std::unique_ptr<BTreeIterator<T>> iteratorBegin() const;
+//    Получить итератор на первый элемент
+
+    std::unique_ptr<BTreeIterator<T>> iteratorEnd() const;
+//    Получить итератор на фиктивный элемент, следующий за последним
+
+    BTreeIterator<T> lowerBound(const T &elem) const;
+//    Итератор по возрастанию на первый элемент, не меньший указанного
+
+    T max() const;
+//    Получить максимальный элемент
+
+    T min() const;
+//    Получить минимальный элемент
+
+    T nth(size_t k) const;
+//    Получить k-й по возрастанию элемент (с нуля) за O(log n)
+
+    size_t rank(const T &elem) const;
+//    Количество элементов, меньших указанного, за O(log n)
+
+    void remove(const T &elem);
+//    Удалить элемент
+
+    void removeMany(const T *arr, size_t size);
+//    Удалить массив элементов
+
+    void setComparator(Compare comparator);
+//    Смена функции сравнения
+
+    void setOrder(tree_order order);
+//    Смена порядка прохода по дереву
+
+    size_t size() const;
+//    Получить количество элементов в дереве
+
+    T *toArray() const;
+//    Получить массив элементов в порядке прохода (память освобождается вызывающим через delete [])
+
+    bool tryAdd(const T &elem);
+//    Добавить элемент, если его еще нет (возвращает, был ли элемент добавлен)
+
+    size_t tryAddMany(const T *arr, size_t size, bool *applied = nullptr);
+//    Добавить массив элементов, пропуская имеющиеся (возвращает количество добавленных)
+
+    bool tryRemove(const T &elem);
+//    Удалить элемент, если он есть (возвращает, был ли элемент удален)
+
+    size_t tryRemoveMany(const T *arr, size_t size, bool *applied = nullptr);
+//    Удалить массив элементов, пропуская отсутствующие (возвращает количество удаленных)
+
+    BTreeIterator<T> upperBound(const T &elem) const;
+//    Итератор по возрастанию на первый элемент, больший указанного
+
+    BTreeSet<T, Compare> &operator=(const BTreeSet<T, Compare> &obj);
+//    Перегрузка оператора присваивания
+
+    BTreeSet<T, Compare> &operator=(BTreeSet<T, Compare> &&obj) noexcept;
+//    Перегрузка оператора присваивания с переносом (за O(1), obj становится пустым)
+
+    BTreeSet<T, Compare> &operator+=(const BTreeSet<T, Compare> &obj);
+//    Перегрузка оператора сложения с присваиванием (то же, что extend)
+
+    template<typename _T, typename _Compare>
+    friend BTreeSet<_T, _Compare> operator+(const BTreeSet<_T, _Compare> &obj1, const BTreeSet<_T, _Compare> &obj2);
+//    Перегрузка оператора сложения (объединение деревьев)
+
+    template<typename _T, typename _Compare>
+    friend std::ostream &operator<<(std::ostream &os, const BTreeSet<_T, _Compare> &obj);
+//    Перегрузка оператора вывода на поток
+
+    template<typename _T, typename _Compare>
+    friend bool operator==(const BTreeSet<_T, _Compare> &obj1, const BTreeSet<_T, _Compare> &obj2);
+//    Перегрузка оператора равенства
+
+    template<typename _T, typename _Compare>
+    friend bool operator!=(const BTreeSet<_T, _Compare> &obj1, const BTreeSet<_T, _Compare> &obj2);
+//    Перегрузка оператора неравенства
+
+private:
+    template<typename>
+    friend class BTreeIterator;
+
+    using Node = BTreeNode<T>;
+    using InnerNode = BTreeInnerNode<T>;
+
+    void borrowFromGreater(Node *node, size_t i);
+//    Перенести в i-го потомка ключ через разделитель из следующего потомка
+
+    void borrowFromSmaller(Node *node, size_t i);
+//    Перенести в i-го потомка ключ через разделитель из предыдущего потомка
+
+    BTreeIterator<T> bound(const T &elem, bool upper) const;
+//    Итератор на первый элемент, не меньший (upper = false) или больший (upper = true) указанного
+
+    static Node *childOf(const Node *node, size_t i);
+//    i-й потомок внутреннего узла
+
+    Node *copyNode(const Node *node, Node *parent, size_t index);
+//    Создать копию ветки с указанным родителем
+
+    Node *createNode(bool leaf);
+//    Выделить пустой лист или внутренний узел
+
+    void dealloc(Node *node);
+//    Освободить память всей ветки
+
+    void destroyNode(Node *node);
+//    Освободить память одного узла
+
+    bool insertKey(const T &elem, const Node *&found, size_t &index);
+//    Добавить элемент, если его еще нет, и найти узел и индекс, где он хранится
+
+    BTreeIterator<T> iteratorAt(const Node *node, size_t index) const;
+//    Итератор по возрастанию на index-й ключ узла (позиция считается по количествам ключей веток за O(log n))
+
+    template<typename A, typename B>
+    bool less(const A &a, const B &b) const;
+//    Меньше ли a, чем b, по функции сравнения дерева
+
+    size_t lowerIndex(const Node *node, const T &elem) const;
+//    Индекс первого ключа узла, не меньшего elem (двоичный поиск внутри узла)
+
+    void mergeChildren(Node *node, size_t i);
+//    Слить i-го и (i + 1)-го потомков вместе с разделяющим ключом
+
+    static void recount(Node *node);
+//    Пересчитать количество ключей ветки по ключам узла и количествам потомков
+
+    static void setChild(Node *node, size_t i, Node *child);
+//    Сделать child i-м потомком внутреннего узла
+
+    void splitChild(Node *node, size_t i);
+//    Разделить заполненного i-го потомка пополам, подняв средний ключ в node
+
+    static constexpr size_t degree_ = Node::degree;
+    static constexpr size_t capacity_ = Node::capacity;
+
+    Node *root_;
+    size_t size_;
+    NodePool<Node> leaves_;
+    NodePool<InnerNode> inner_nodes_;
+
+    tree_order order_;
+    Compare comparator_;
+
+    static constexpr bool three_way_ =
+            !std::is_same<std::invoke_result_t<const Compare &, const T &, const T &>, bool>::value;
+};
+
+
+template<typename T, typename Compare>
+BTreeSet<T, Compare>::BTreeSet(tree_order order, Compare comparator) {
+    root_ = nullptr;
+    size_ = 0;
+    order_ = order;
+    comparator_ = comparator;
+}
+
+template<typename T, typename Compare>
+BTreeSet<T, Compare>::BTreeSet(const BTreeSet<T, Compare> &obj) {
+    root_ = nullptr;
+    size_ = 0;
+    *this = obj;
+}
+
+template<typename T, typename Compare>
+BTreeSet<T, Compare>::BTreeSet(BTreeSet<T, Compare> &&obj) noexcept {
+    root_ = obj.root_;
+    size_ = obj.size_;
+    leaves_ = std::move(obj.leaves_);
+    inner_nodes_ = std::move(obj.inner_nodes_);
+    order_ = obj.order_;
+    comparator_ = obj.comparator_;
+    obj.root_ = nullptr;
+    obj.size_ = 0;
+}
+
+template<typename T, typename Compare>
+BTreeSet<T, Compare>::BTreeSet(std::initializer_list<T> &lst, tree_order order, Compare comparator) {
+    root_ = nullptr;
+    size_ = 0;
+    order_ = order;
+    comparator_ = comparator;
+    for (auto el : lst) {
+        add(el);
+    }
+}
+
+template<typename T, typename Compare>
+BTreeSet<T, Compare>::~BTreeSet() noexcept {
+    clear();
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::add(const T &elem) {
+    if (!tryAdd(elem)) {
+        throw BSTDuplicateValueException("duplicate value to add");
+    }
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::addMany(const T *arr, size_t size) {
+    if (tryAddMany(arr, size) != size) {
+        throw BSTDuplicateValueException("duplicate values to add");
+    }
+}
+
+template<typename T, typename Compare>
+BTreeIterator<T> BTreeSet<T, Compare>::begin() const {
+    return BTreeIterator<T>(*this);
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::clear() {
+    if constexpr (!std::is_trivially_destructible<T>::value) {
+        dealloc(root_);
+    }
+    root_ = nullptr;
+    size_ = 0;
+    leaves_.clear();
+    inner_nodes_.clear();
+}
+
+template<typename T, typename Compare>
+bool BTreeSet<T, Compare>::contains(const T &elem) const {
+    const Node *node = root_;
+    while (node) {
+        size_t i = lowerIndex(node, elem);
+        if (i < node->size && !less(elem, node->keys[i])) {
+            return true;
+        }
+        if (node->leaf) {
+            return false;
+        }
+        node = childOf(node, i);
+    }
+    return false;
+}
+
+template<typename T, typename Compare>
+bool BTreeSet<T, Compare>::contains(const BTreeSet<T, Compare> &obj) const {
+    if (obj.isEmpty()) {
+        throw BSTEmptyException("can't check empty tree presence");
+    }
+    if (obj.size() > size()) {
+        return false;
+    }
+    for (BTreeIterator<T> it(obj, IN_ORDER); !it.isEnd(); it.next()) {
+        if (!contains(it.value())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::copy(const BTreeSet<T, Compare> &obj) {
+    *this = obj;
+}
+
+template<typename T, typename Compare>
+size_t BTreeSet<T, Compare>::countRange(const T &from, const T &to) const {
+    if (!less(from, to)) {
+        return 0;
+    }
+    return rank(to) - rank(from);
+}
+
+template<typename T, typename Compare>
+BTreeIterator<T> BTreeSet<T, Compare>::end() const {
+    BTreeIterator<T> it(*this);
+    it.end();
+    return it;
+}
+
+template<typename T, typename Compare>
+size_t BTreeSet<T, Compare>::erase(const T &elem) {
+    return tryRemove(elem) ? 1 : 0;
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::extend(const BTreeSet<T, Compare> &obj) {
+    if (obj.isEmpty()) {
+        throw BSTEmptyException("empty tree to extend by");
+    }
+    for (BTreeIterator<T> it(obj, IN_ORDER); !it.isEnd(); it.next()) {
+        tryAdd(it.value());
+    }
+}
+
+template<typename T, typename Compare>
+BTreeIterator<T> BTreeSet<T, Compare>::find(const T &elem) const {
+    const Node *node = root_;
+    while (node) {
+        size_t i = lowerIndex(node, elem);
+        if (i < node->size && !less(elem, node->keys[i])) {
+            return iteratorAt(node, i);
+        }
+        if (node->leaf) {
+            break;
+        }
+        node = childOf(node, i);
+    }
+    return iteratorAt(nullptr, 0);
+}
+
+template<typename T, typename Compare>
+template<typename Visitor>
+void BTreeSet<T, Compare>::forEachInRange(const T &from, const T &to, Visitor visitor) const {
+    for (BTreeIterator<T> it = bound(from, false); !it.isEnd() && less(it.value(), to); it.next()) {
+        visitor(it.value());
+    }
+}
+
+template<typename T, typename Compare>
+std::pair<BTreeIterator<T>, bool> BTreeSet<T, Compare>::insert(const T &elem) {
+    const Node *found = nullptr;
+    size_t index = 0;
+    bool inserted = insertKey(elem, found, index);
+    return {iteratorAt(found, index), inserted};
+}
+
+template<typename T, typename Compare>
+bool BTreeSet<T, Compare>::isEmpty() const {
+    return !size_;
+}
+
+template<typename T, typename Compare>
+std::unique_ptr<BTreeIterator<T>> BTreeSet<T, Compare>::iteratorBegin() const {
+    auto it = std::make_unique<BTreeIterator<T>>(*this);
+    it->begin();
+    return it;
+}
+
+template<typename T, typename Compare>
+std::unique_ptr<BTreeIterator<T>> BTreeSet<T, Compare>::iteratorEnd() const {
+    auto it = std::make_unique<BTreeIterator<T>>(*this);
+    it->end();
+    return it;
+}
+
+template<typename T, typename Compare>
+BTreeIterator<T> BTreeSet<T, Compare>::lowerBound(const T &elem) const {
+    return bound(elem, false);
+}
+
+template<typename T, typename Compare>
+T BTreeSet<T, Compare>::max() const {
+    if (isEmpty()) {
+        throw BSTEmptyException("can't find empty tree max value");
+    }
+    const Node *node = root_;
+    while (!node->leaf) {
+        node = childOf(node, node->size);
+    }
+    return node->keys[node->size - 1];
+}
+
+template<typename T, typename Compare>
+T BTreeSet<T, Compare>::min() const {
+    if (isEmpty()) {
+        throw BSTEmptyException("can't find empty tree min value");
+    }
+    const Node *node = root_;
+    while (!node->leaf) {
+        node = childOf(node, 0);
+    }
+    return node->keys[0];
+}
+
+template<typename T, typename Compare>
+T BTreeSet<T, Compare>::nth(size_t k) const {
+    if (k >= size()) {
+        throw BSTOutOfRangeException("element index out of range");
+    }
+    const Node *node = root_;
+    while (!node->leaf) {
+        size_t i = 0;
+        while (k >= childOf(node, i)->count) {
+            k -= childOf(node, i)->count;
+            if (!k) {
+                return node->keys[i];
+            }
+            k--;
+            i++;
+        }
+        node = childOf(node, i);
+    }
+    return node->keys[k];
+}
+
+template<typename T, typename Compare>
+size_t BTreeSet<T, Compare>::rank(const T &elem) const {
+    size_t rank = 0;
+    const Node *node = root_;
+    while (node) {
+        size_t i = lowerIndex(node, elem);
+        rank += i;
+        if (node->leaf) {
+            break;
+        }
+        for (size_t j = 0; j < i; j++) {
+            rank += childOf(node, j)->count;
+        }
+        if (i < node->size && !less(elem, node->keys[i])) {
+            rank += childOf(node, i)->count;
+            break;
+        }
+        node = childOf(node, i);
+    }
+    return rank;
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::remove(const T &elem) {
+    if (!tryRemove(elem)) {
+        throw BSTNonexistentValueException("nonexistent value to remove");
+    }
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::removeMany(const T *arr, size_t size) {
+    if (tryRemoveMany(arr, size) != size) {
+        throw BSTNonexistentValueException("nonexistent values to remove");
+    }
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::setComparator(Compare comparator) {
+    comparator_ = comparator;
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::setOrder(tree_order order) {
+    order_ = order;
+}
+
+template<typename T, typename Compare>
+size_t BTreeSet<T, Compare>::size() const {
+    return size_;
+}
+
+template<typename T, typename Compare>
+T *BTreeSet<T, Compare>::toArray() const {
+    if (isEmpty()) {
+        throw BSTEmptyException("can't convert empty tree");
+    }
+    T *arr = new T[size_];
+    size_t size = 0;
+    for (BTreeIterator<T> it(*this); !it.isEnd(); it.next()) {
+        arr[size++] = it.value();
+    }
+    return arr;
+}
+
+template<typename T, typename Compare>
+bool BTreeSet<T, Compare>::tryAdd(const T &elem) {
+    const Node *found = nullptr;
+    size_t index = 0;
+    return insertKey(elem, found, index);
+}
+
+template<typename T, typename Compare>
+size_t BTreeSet<T, Compare>::tryAddMany(const T *arr, size_t size, bool *applied) {
+    size_t added = 0;
+    for (size_t i = 0; i < size; i++) {
+        bool is_added = tryAdd(arr[i]);
+        if (applied) {
+            applied[i] = is_added;
+        }
+        added += is_added;
+    }
+    return added;
+}
+
+// Перед спуском в потомка в нем гарантируется хотя бы degree ключей, поэтому удаление
+// из листа не нарушает свойств дерева. Ключ внутреннего узла заменяется соседним по
+// значению ключом из листа, после чего удаляется уже этот ключ
+template<typename T, typename Compare>
+bool BTreeSet<T, Compare>::tryRemove(const T &elem) {
+    if (!root_) {
+        return false;
+    }
+    const T *target = &elem;
+    Node *node = root_;
+    bool removed = false;
+    while (true) {
+        size_t i = lowerIndex(node, *target);
+        bool found = i < node->size && !less(*target, node->keys[i]);
+        if (node->leaf) {
+            if (found) {
+                std::move(node->keys + i + 1, node->keys + node->size, node->keys + i);
+                node->size--;
+                for (Node *ancestor = node; ancestor; ancestor = ancestor->parent) {
+                    ancestor->count--;
+                }
+                removed = true;
+            }
+            break;
+        }
+        if (found) {
+            Node *smaller = childOf(node, i);
+            Node *greater = childOf(node, i + 1);
+            if (smaller->size >= degree_) {
+                Node *leaf = smaller;
+                while (!leaf->leaf) {
+                    leaf = childOf(leaf, leaf->size);
+                }
+                node->keys[i] = leaf->keys[leaf->size - 1];
+                target = &node->keys[i];
+                node = smaller;
+            } else if (greater->size >= degree_) {
+                Node *leaf = greater;
+                while (!leaf->leaf) {
+                    leaf = childOf(leaf, 0);
+                }
+                node->keys[i] = leaf->keys[0];
+                target = &node->keys[i];
+                node = greater;
+            } else {
+                mergeChildren(node, i);
+                node = smaller;
+            }
+            continue;
+        }
+        if (childOf(node, i)->size < degree_) {
+            if (i > 0 && childOf(node, i - 1)->size >= degree_) {
+                borrowFromSmaller(node, i);
+            } else if (i < node->size && childOf(node, i + 1)->size >= degree_) {
+                borrowFromGreater(node, i);
+            } else if (i < node->size) {
+                mergeChildren(node, i);
+            } else {
+                mergeChildren(node, i - 1);
+                i--;
+            }
+        }
+        node = childOf(node, i);
+    }
+
+    if (!root_->size) {
+        Node *root = root_;
+        if (root->leaf) {
+            root_ = nullptr;
+        } else {
+            root_ = childOf(root, 0);
+            root_->parent = nullptr;
+            root_->index = 0;
+        }
+        destroyNode(root);
+    }
+    size_ -= removed;
+    return removed;
+}
+
+template<typename T, typename Compare>
+size_t BTreeSet<T, Compare>::tryRemoveMany(const T *arr, size_t size, bool *applied) {
+    size_t removed = 0;
+    for (size_t i = 0; i < size; i++) {
+        bool is_removed = tryRemove(arr[i]);
+        if (applied) {
+            applied[i] = is_removed;
+        }
+        removed += is_removed;
+    }
+    return removed;
+}
+
+template<typename T, typename Compare>
+BTreeIterator<T> BTreeSet<T, Compare>::upperBound(const T &elem) const {
+    return bound(elem, true);
+}
+
+template<typename T, typename Compare>
+BTreeSet<T, Compare> &BTreeSet<T, Compare>::operator=(const BTreeSet<T, Compare> &obj) {
+    if (this == &obj) {
+        return *this;
+    }
+    clear();
+    order_ = obj.order_;
+    comparator_ = obj.comparator_;
+    root_ = obj.root_ ? copyNode(obj.root_, nullptr, 0) : nullptr;
+    size_ = obj.size_;
+    return *this;
+}
+
+template<typename T, typename Compare>
+BTreeSet<T, Compare> &BTreeSet<T, Compare>::operator=(BTreeSet<T, Compare> &&obj) noexcept {
+    if (this == &obj) {
+        return *this;
+    }
+    clear();
+    root_ = obj.root_;
+    size_ = obj.size_;
+    leaves_ = std::move(obj.leaves_);
+    inner_nodes_ = std::move(obj.inner_nodes_);
+    order_ = obj.order_;
+    comparator_ = obj.comparator_;
+    obj.root_ = nullptr;
+    obj.size_ = 0;
+    return *this;
+}
+
+template<typename T, typename Compare>
+BTreeSet<T, Compare> &BTreeSet<T, Compare>::operator+=(const BTreeSet<T, Compare> &obj) {
+    extend(obj);
+    return *this;
+}
+
+template<typename _T, typename _Compare>
+BTreeSet<_T, _Compare> operator+(const BTreeSet<_T, _Compare> &obj1, const BTreeSet<_T, _Compare> &obj2) {
+    BTreeSet<_T, _Compare> sum(obj1);
+    sum.extend(obj2);
+    return sum;
+}
+
+template<typename _T, typename _Compare>
+std::ostream &operator<<(std::ostream &os, const BTreeSet<_T, _Compare> &obj) {
+    os << "{";
+    for (BTreeIterator<_T> it(obj); !it.isEnd(); it.next()) {
+        if (it.hasPrevious()) {
+            os << ", ";
+        }
+        os << *it;
+    }
+    os << "}";
+    return os;
+}
+
+template<typename _T, typename _Compare>
+bool operator==(const BTreeSet<_T, _Compare> &obj1, const BTreeSet<_T, _Compare> &obj2) {
+    if (obj1.order_ != obj2.order_) {
+        return false;
+    }
+    if (obj1.size() != obj2.size()) {
+        return false;
+    }
+    for (BTreeIterator<_T> it1(obj1), it2(obj2); !it1.isEnd(); it1.next(), it2.next()) {
+        if (*it1 != *it2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename _T, typename _Compare>
+bool operator!=(const BTreeSet<_T, _Compare> &obj1, const BTreeSet<_T, _Compare> &obj2) {
+    return !(obj1 == obj2);
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::borrowFromGreater(Node *node, size_t i) {
+    Node *child = childOf(node, i);
+    Node *sibling = childOf(node, i + 1);
+    child->keys[child->size] = std::move(node->keys[i]);
+    node->keys[i] = std::move(sibling->keys[0]);
+    std::move(sibling->keys + 1, sibling->keys + sibling->size, sibling->keys);
+    if (!child->leaf) {
+        setChild(child, child->size + 1, childOf(sibling, 0));
+        for (size_t j = 0; j < sibling->size; j++) {
+            setChild(sibling, j, childOf(sibling, j + 1));
+        }
+    }
+    child->size++;
+    sibling->size--;
+    recount(child);
+    recount(sibling);
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::borrowFromSmaller(Node *node, size_t i) {
+    Node *child = childOf(node, i);
+    Node *sibling = childOf(node, i - 1);
+    std::move_backward(child->keys, child->keys + child->size, child->keys + child->size + 1);
+    child->keys[0] = std::move(node->keys[i - 1]);
+    node->keys[i - 1] = std::move(sibling->keys[sibling->size - 1]);
+    if (!child->leaf) {
+        for (size_t j = child->size + 1; j > 0; j--) {
+            setChild(child, j, childOf(child, j - 1));
+        }
+        setChild(child, 0, childOf(sibling, sibling->size));
+    }
+    child->size++;
+    sibling->size--;
+    recount(child);
+    recount(sibling);
+}
+
+template<typename T, typename Compare>
+BTreeIterator<T> BTreeSet<T, Compare>::bound(const T &elem, bool upper) const {
+    const Node *found = nullptr;
+    size_t found_index = 0;
+    const Node *node = root_;
+    while (node) {
+        size_t i = lowerIndex(node, elem);
+        if (upper && i < node->size && !less(elem, node->keys[i])) {
+            i++;
+        }
+        if (i < node->size) {
+            found = node;
+            found_index = i;
+        }
+        if (node->leaf) {
+            break;
+        }
+        node = childOf(node, i);
+    }
+    return iteratorAt(found, found_index);
+}
+
+template<typename T, typename Compare>
+BTreeNode<T> *BTreeSet<T, Compare>::childOf(const Node *node, size_t i) {
+    return static_cast<const InnerNode *>(node)->children[i];
+}
+
+template<typename T, typename Compare>
+BTreeNode<T> *BTreeSet<T, Compare>::copyNode(const Node *node, Node *parent, size_t index) {
+    Node *copy = createNode(node->leaf);
+    copy->parent = parent;
+    copy->index = index;
+    copy->size = node->size;
+    copy->count = node->count;
+    std::copy(node->keys, node->keys + node->size, copy->keys);
+    if (!node->leaf) {
+        for (size_t i = 0; i <= node->size; i++) {
+            static_cast<InnerNode *>(copy)->children[i] = copyNode(childOf(node, i), copy, i);
+        }
+    }
+    return copy;
+}
+
+template<typename T, typename Compare>
+BTreeNode<T> *BTreeSet<T, Compare>::createNode(bool leaf) {
+    Node *node = leaf ? leaves_.create() : inner_nodes_.create();
+    node->leaf = leaf;
+    return node;
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::dealloc(Node *node) {
+    if (!node) {
+        return;
+    }
+    std::vector<Node *> stack = {node};
+    while (!stack.empty()) {
+        Node *current = stack.back();
+        stack.pop_back();
+        if (!current->leaf) {
+            for (size_t i = 0; i <= current->size; i++) {
+                stack.push_back(childOf(current, i));
+            }
+        }
+        destroyNode(current);
+    }
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::destroyNode(Node *node) {
+    if (node->leaf) {
+        leaves_.destroy(node);
+    } else {
+        inner_nodes_.destroy(static_cast<InnerNode *>(node));
+    }
+}
+
+// Заполненные узлы делятся по пути вниз, поэтому вставка в лист всегда возможна без подъема обратно
+template<typename T, typename Compare>
+bool BTreeSet<T, Compare>::insertKey(const T &elem, const Node *&found, size_t &index) {
+    if (!root_) {
+        root_ = createNode(true);
+    } else if (root_->size == capacity_) {
+        Node *root = createNode(false);
+        root->count = root_->count;
+        setChild(root, 0, root_);
+        root_ = root;
+        splitChild(root_, 0);
+    }
+
+    Node *node = root_;
+    while (true) {
+        size_t i = lowerIndex(node, elem);
+        if (i < node->size && !less(elem, node->keys[i])) {
+            found = node;
+            index = i;
+            return false;
+        }
+        if (node->leaf) {
+            std::move_backward(node->keys + i, node->keys + node->size, node->keys + node->size + 1);
+            node->keys[i] = elem;
+            node->size++;
+            for (Node *ancestor = node; ancestor; ancestor = ancestor->parent) {
+                ancestor->count++;
+            }
+            size_++;
+            found = node;
+            index = i;
+            return true;
+        }
+        if (childOf(node, i)->size == capacity_) {
+            splitChild(node, i);
+            if (less(node->keys[i], elem)) {
+                i++;
+            } else if (!less(elem, node->keys[i])) {
+                found = node;
+                index = i;
+                return false;
+            }
+        }
+        node = childOf(node, i);
+    }
+}
+
+// Позиция - количество ключей левее: в ветках левее ключа внутри узла и левее пути при подъеме к корню
+template<typename T, typename Compare>
+BTreeIterator<T> BTreeSet<T, Compare>::iteratorAt(const Node *node, size_t index) const {
+    BTreeIterator<T> it(*this, IN_ORDER);
+    if (!node) {
+        it.end();
+        return it;
+    }
+    size_t pos = index;
+    if (!node->leaf) {
+        for (size_t j = 0; j <= index; j++) {
+            pos += childOf(node, j)->count;
+        }
+    }
+    for (const Node *current = node; current->parent; current = current->parent) {
+        pos += current->index;
+        for (size_t j = 0; j < current->index; j++) {
+            pos += childOf(current->parent, j)->count;
+        }
+    }
+    it.position_ = {node, index};
+    it.pos_ = pos;
+    return it;
+}
+
+template<typename T, typename Compare>
+template<typename A, typename B>
+bool BTreeSet<T, Compare>::less(const A &a, const B &b) const {
+    if constexpr (three_way_) {
+        return comparator_(a, b) < 0;
+    } else {
+        return comparator_(a, b);
+    }
+}
+
+template<typename T, typename Compare>
+size_t BTreeSet<T, Compare>::lowerIndex(const Node *node, const T &elem) const {
+    size_t low = 0;
+    size_t high = node->size;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (less(node->keys[middle], elem)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::mergeChildren(Node *node, size_t i) {
+    Node *child = childOf(node, i);
+    Node *sibling = childOf(node, i + 1);
+    child->keys[child->size] = std::move(node->keys[i]);
+    std::move(sibling->keys, sibling->keys + sibling->size, child->keys + child->size + 1);
+    if (!child->leaf) {
+        for (size_t j = 0; j <= sibling->size; j++) {
+            setChild(child, child->size + 1 + j, childOf(sibling, j));
+        }
+    }
+    child->size += sibling->size + 1;
+
+    std::move(node->keys + i + 1, node->keys + node->size, node->keys + i);
+    for (size_t j = i + 1; j < node->size; j++) {
+        setChild(node, j, childOf(node, j + 1));
+    }
+    node->size--;
+    destroyNode(sibling);
+    recount(child);
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::recount(Node *node) {
+    node->count = node->size;
+    if (!node->leaf) {
+        for (size_t i = 0; i <= node->size; i++) {
+            node->count += childOf(node, i)->count;
+        }
+    }
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::setChild(Node *node, size_t i, Node *child) {
+    static_cast<InnerNode *>(node)->children[i] = child;
+    child->parent = node;
+    child->index = i;
+}
+
+template<typename T, typename Compare>
+void BTreeSet<T, Compare>::splitChild(Node *node, size_t i) {
+    Node *child = childOf(node, i);
+    Node *sibling = createNode(child->leaf);
+    std::move(child->keys + degree_, child->keys + capacity_, sibling->keys);
+    if (!child->leaf) {
+        for (size_t j = 0; j < degree_; j++) {
+            setChild(sibling, j, childOf(child, degree_ + j));
+        }
+    }
+    sibling->size = degree_ - 1;
+    child->size = degree_ - 1;
+
+    for (size_t j = node->size; j > i; j--) {
+        setChild(node, j + 1, childOf(node, j));
+    }
+    std::move_backward(node->keys + i, node->keys + node->size, node->keys + node->size + 1);
+    node->keys[i] = std::move(child->keys[degree_ - 1]);
+    setChild(node, i + 1, sibling);
+    node->size++;
+    recount(child);
+    recount(sibling);
+}
+
+
+// Итератор переходит по ссылкам на родителей, следующий элемент находится за амортизированное O(1)
+template<typename T>
+class BTreeIterator {
+public:
+    BTreeIterator() = delete;
+//    Конструктор по умолчанию (удален)
+
+    template<typename Compare>
+    explicit BTreeIterator(const BTreeSet<T, Compare> &tree);
+//    Перегрузка конструктора
+
+    template<typename Compare>
+    BTreeIterator(const BTreeSet<T, Compare> &tree, tree_order order);
+//    Перегрузка конструктора (проход в указанном порядке вместо порядка дерева)
+
+    BTreeIterator(const BTreeIterator<T> &obj) = default;
+//    Конструктор копирования
+
+    ~BTreeIterator() = default;
+//    Деструктор
+
+    BTreeIterator<T> &begin();
+//    Получить итератор на первый элемент
+
+    BTreeIterator<T> &end();
+//    Получить итератор на фиктивный элемент, следующий за последним
+
+    bool hasNext() const;
+//    Имеет ли итератор следующий элемент (в т. ч. фиктивный)
+
+    bool hasPrevious() const;
+//    Имеет ли итератор предыдущий элемент
+
+    bool isEnd() const;
+//    Находится ли итератор на фиктивном элементе, следующем за последним
+
+    void next();
+//    Сместиться на следующий элемент
+
+    void previous();
+//    Сместиться на предыдущий элемент
+
+    const T &value() const;
+//    Получить значение текущего элемента
+
+    BTreeIterator<T> &operator=(const BTreeIterator<T> &obj) = default;
+//    Перегрузка оператора присваивания
+
+    BTreeIterator<T> &operator++();
+//    Перегрузка оператора префиксного инкремента
+
+    BTreeIterator<T> &operator--();
+//    Перегрузка оператора префиксного декремента
+
+    BTreeIterator<T> operator++(int);
+//    Перегрузка оператора постфиксного инкремента
+
+    BTreeIterator<T> operator--(int);
+//    Перегрузка оператора постфиксного декремента
+
+    const T &operator*() const;
+//    Перегрузка оператора разыменования
+
+    bool operator==(const BTreeIterator<T> &it) const;
+//    Перегрузка оператора равенства (сравниваются позиции итераторов)
+
+    bool operator!=(const BTreeIterator<T> &it) const;
+//    Перегрузка оператора неравенства
+
+    bool operator<(const BTreeIterator<T> &it) const;
+//    Перегрузка оператора "меньше" (сравниваются позиции итераторов)
+
+    bool operator>(const BTreeIterator<T> &it) const;
+//    Перегрузка оператора "больше" (сравниваются позиции итераторов)
+
+private:
+    template<typename, typename>
+    friend class BTreeSet;
+
+    using Node = BTreeNode<T>;
+    using InnerNode = BTreeInnerNode<T>;
+
+    struct Position {
+        const Node *node; // nullptr - фиктивный элемент
+        size_t index;
+    };
+
+    Position first() const;
+//    Первый элемент в порядке прохода
+
+    Position last() const;
+//    Последний элемент в порядке прохода
+
+    static Position inOrderNext(Position position);
+//    Следующий по возрастанию элемент
+
+    static Position inOrderPrevious(Position position);
+//    Предыдущий по возрастанию элемент
+
+    static Position leftmost(const Node *node);
+//    Минимальный элемент ветки
+
+    static Position rightmost(const Node *node);
+//    Максимальный элемент ветки
+
+    Position nextPosition(Position position) const;
+//    Следующий элемент в порядке прохода
+
+    Position previousPosition(Position position) const;
+//    Предыдущий элемент в порядке прохода
+
+    static const Node *childOf(const Node *node, size_t i);
+//    i-й потомок внутреннего узла
+
+    const Node *root_;
+    Position position_;
+    tree_order order_;
+    size_t size_;
+    size_t pos_;
+};
+
+
+template<typename T>
+template<typename Compare>
+BTreeIterator<T>::BTreeIterator(const BTreeSet<T, Compare> &tree)
+        : BTreeIterator(tree, tree.order_) {}
+
+template<typename T>
+template<typename Compare>
+BTreeIterator<T>::BTreeIterator(const BTreeSet<T, Compare> &tree, tree_order order) {
+    root_ = tree.root_;
+    order_ = order;
+    size_ = tree.size_;
+    begin();
+}
+
+template<typename T>
+BTreeIterator<T> &BTreeIterator<T>::begin() {
+    position_ = first();
+    pos_ = 0;
+    return *this;
+}
+
+template<typename T>
+BTreeIterator<T> &BTreeIterator<T>::end() {
+    position_ = {nullptr, 0};
+    pos_ = size_;
+    return *this;
+}
+
+template<typename T>
+bool BTreeIterator<T>::hasNext() const {
+    return pos_ < size_;
+}
+
+template<typename T>
+bool BTreeIterator<T>::hasPrevious() const {
+    return pos_ > 0;
+}
+
+template<typename T>
+bool BTreeIterator<T>::isEnd() const {
+    return pos_ == size_;
+}
+
+template<typename T>
+void BTreeIterator<T>::next() {
+    if (!hasNext()) {
+        throw BSTIteratorOutOfRangeException("iterator out of range");
+    }
+    pos_++;
+    position_ = pos_ == size_ ? Position{nullptr, 0} : nextPosition(position_);
+}
+
+template<typename T>
+void BTreeIterator<T>::previous() {
+    if (!hasPrevious()) {
+        throw BSTIteratorOutOfRangeException("iterator out of range");
+    }
+    position_ = position_.node ? previousPosition(position_) : last();
+    pos_--;
+}
+
+template<typename T>
+const T &BTreeIterator<T>::value() const {
+    if (isEnd()) {
+        throw BSTIteratorAccessingEndValueException("end value to access");
+    }
+    return position_.node->keys[position_.index];
+}
+
+template<typename T>
+BTreeIterator<T> &BTreeIterator<T>::operator++() {
+    next();
+    return *this;
+}
+
+template<typename T>
+BTreeIterator<T> &BTreeIterator<T>::operator--() {
+    previous();
+    return *this;
+}
+
+template<typename T>
+BTreeIterator<T> BTreeIterator<T>::operator++(int) {
+    BTreeIterator<T> old(*this);
+    next();
+    return old;
+}
+
+template<typename T>
+BTreeIterator<T> BTreeIterator<T>::operator--(int) {
+    BTreeIterator<T> old(*this);
+    previous();
+    return old;
+}
+
+template<typename T>
+const T &BTreeIterator<T>::operator*() const {
+    return value();
+}
+
+template<typename T>
+bool BTreeIterator<T>::operator==(const BTreeIterator<T> &it) const {
+    return root_ == it.root_ && pos_ == it.pos_;
+}
+
+template<typename T>
+bool BTreeIterator<T>::operator!=(const BTreeIterator<T> &it) const {
+    return !(*this == it);
+}
+
+template<typename T>
+bool BTreeIterator<T>::operator<(const BTreeIterator<T> &it) const {
+    return pos_ < it.pos_;
+}
+
+template<typename T>
+bool BTreeIterator<T>::operator>(const BTreeIterator<T> &it) const {
+    return pos_ > it.pos_;
+}
+
+template<typename T>
+typename BTreeIterator<T>::Position BTreeIterator<T>::first() const {
+    if (!root_) {
+        return {nullptr, 0};
+    }
+    switch (order_) {
+        case PRE_ORDER:
+            return {root_, 0};
+        case REVERSE_ORDER:
+            return rightmost(root_);
+        default:
+            return leftmost(root_);
+    }
+}
+
+template<typename T>
+typename BTreeIterator<T>::Position BTreeIterator<T>::last() const {
+    if (!root_) {
+        return {nullptr, 0};
+    }
+    switch (order_) {
+        case POST_ORDER:
+            return {root_, root_->size - 1};
+        case REVERSE_ORDER:
+            return leftmost(root_);
+        default:
+            return rightmost(root_);
+    }
+}
+
+template<typename T>
+typename BTreeIterator<T>::Position BTreeIterator<T>::inOrderNext(Position position) {
+    const Node *node = position.node;
+    if (!node->leaf) {
+        return leftmost(childOf(node, position.index + 1));
+    }
+    if (position.index + 1 < node->size) {
+        return {node, position.index + 1};
+    }
+    while (node->parent && node->index == node->parent->size) {
+        node = node->parent;
+    }
+    return {node->parent, node->index};
+}
+
+template<typename T>
+typename BTreeIterator<T>::Position BTreeIterator<T>::inOrderPrevious(Position position) {
+    const Node *node = position.node;
+    if (!node->leaf) {
+        return rightmost(childOf(node, position.index));
+    }
+    if (position.index > 0) {
+        return {node, position.index - 1};
+    }
+    while (node->parent && !node->index) {
+        node = node->parent;
+    }
+    return {node->parent, node->index - 1};
+}
+
+template<typename T>
+typename BTreeIterator<T>::Position BTreeIterator<T>::leftmost(const Node *node) {
+    while (!node->leaf) {
+        node = childOf(node, 0);
+    }
+    return {node, 0};
+}
+
+template<typename T>
+typename BTreeIterator<T>::Position BTreeIterator<T>::rightmost(const Node *node) {
+    while (!node->leaf) {
+        node = childOf(node, node->size);
+    }
+    return {node, node->size - 1};
+}
+
+// PRE_ORDER: ключи узла, затем ветки по порядку; POST_ORDER: ветки по порядку, затем ключи узла
+template<typename T>
+typename BTreeIterator<T>::Position BTreeIterator<T>::nextPosition(Position position) const {
+    const Node *node = position.node;
+    switch (order_) {
+        case IN_ORDER:
+            return inOrderNext(position);
+        case REVERSE_ORDER:
+            return inOrderPrevious(position);
+        case PRE_ORDER:
+            if (position.index + 1 < node->size) {
+                return {node, position.index + 1};
+            }
+            if (!node->leaf) {
+                return {childOf(node, 0), 0};
+            }
+            while (node->parent && node->index == node->parent->size) {
+                node = node->parent;
+            }
+            return {childOf(node->parent, node->index + 1), 0};
+        case POST_ORDER:
+            if (position.index + 1 < node->size) {
+                return {node, position.index + 1};
+            }
+            if (node->index < node->parent->size) {
+                return leftmost(childOf(node->parent, node->index + 1));
+            }
+            return {node->parent, 0};
+    }
+    return {nullptr, 0};
+}
+
+template<typename T>
+typename BTreeIterator<T>::Position BTreeIterator<T>::previousPosition(Position position) const {
+    const Node *node = position.node;
+    switch (order_) {
+        case IN_ORDER:
+            return inOrderPrevious(position);
+        case REVERSE_ORDER:
+            return inOrderNext(position);
+        case PRE_ORDER:
+            if (position.index > 0) {
+                return {node, position.index - 1};
+            }
+            if (!node->index) {
+                return {node->parent, node->parent->size - 1};
+            }
+            return rightmost(childOf(node->parent, node->index - 1));
+        case POST_ORDER:
+            if (position.index > 0) {
+                return {node, position.index - 1};
+            }
+            if (!node->leaf) {
+                node = childOf(node, node->size);
+                return {node, node->size - 1};
+            }
+            while (node->parent && !node->index) {
+                node = node->parent;
+            }
+            node = childOf(node->parent, node->index - 1);
+            return {node, node->size - 1};
+    }
+    return {nullptr, 0};
+}
+
+template<typename T>
+const BTreeNode<T> *BTreeIterator<T>::childOf(const Node *node, size_t i) {
+    return static_cast<const InnerNode *>(node)->children[i];
+}
+
+#endif //CONTAINER_BTREE_SET_H
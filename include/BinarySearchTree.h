@@ -1,13 +1,26 @@
 #ifndef CONTAINER_BINARY_SEARCH_TREE_H
 #define CONTAINER_BINARY_SEARCH_TREE_H
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <initializer_list>
+#include <iterator>
 #include <memory>
+#include <new>
 #include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 #include "BSTException.h"
+#include "BSTFile.h"
 #include "BSTIteratorException.h"
+#include "FrozenBinarySearchTree.h"
+#include "NodePool.h"
+#include "Parallel.h"
 
 enum tree_order {
     IN_ORDER,
@@ -16,24 +29,107 @@ enum tree_order {
     POST_ORDER
 };
 
+enum tree_balance {
+    UNBALANCED,
+    AVL
+};
+
 template<typename T>
 class Iterator;
 
+template<typename T, typename Compare = std::less<T>>
+class BinarySearchTree;
+
+template<typename T>
+class DynamicComparator {
+public:
+    DynamicComparator();
+//    Конструктор по умолчанию (сравнение операторами < и >)
+
+    template<typename Function, typename = std::enable_if_t<
+            !std::is_same<std::decay_t<Function>, DynamicComparator<T>>::value>>
+    DynamicComparator(Function function);
+//    Конструктор из произвольной функции сравнения int(T, T)
+
+    int operator()(const T &a, const T &b) const;
+//    Сравнить элементы (отрицательное, если a < b; 0, если равны; положительное, если a > b)
+
+private:
+    static int defaultCompare(const T &a, const T &b);
+//    Функция сравнения элементов по умолчанию
+
+    std::function<int(const T &, const T &)> function_;
+};
+
+template<typename T>
+DynamicComparator<T>::DynamicComparator() {
+    function_ = defaultCompare;
+}
+
+template<typename T>
+template<typename Function, typename>
+DynamicComparator<T>::DynamicComparator(Function function) {
+    function_ = std::move(function);
+}
+
+template<typename T>
+int DynamicComparator<T>::operator()(const T &a, const T &b) const {
+    return function_(a, b);
+}
+
+template<typename T>
+int DynamicComparator<T>::defaultCompare(const T &a, const T &b) {
+    if (a > b) {
+        return 1;
+    } else if (a < b) {
+        return -1;
+    } else {
+        return 0;
+    }
+}
+
 template<typename T>
+struct BSTNode {
+    BSTNode<T> *parent; // root->parent == nullptr
+    BSTNode<T> *smaller_child;
+    BSTNode<T> *greater_child;
+    size_t count; // количество элементов в ветке
+    int height;
+    T value;
+};
+
+// Compare - либо предикат "меньше" (bool(const T &, const T &), как std::less),
+// либо трехсторонняя функция сравнения (int(const T &, const T &), как DynamicComparator)
+template<typename T, typename Compare>
 class BinarySearchTree {
 public:
+    using key_type = T;
+    using value_type = T;
+    using key_compare = Compare;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T &;
+    using const_reference = const T &;
+    using iterator = Iterator<T>;
+    using const_iterator = Iterator<T>;
+    using reverse_iterator = std::reverse_iterator<Iterator<T>>;
+    using const_reverse_iterator = std::reverse_iterator<Iterator<T>>;
+//    Типы в стиле std::set (элементы неизменяемы, поэтому итераторы только константные)
+
     explicit BinarySearchTree(tree_order order = IN_ORDER,
-                              std::function<int(T, T)> comparator = defaultCompare);
+                              Compare comparator = Compare(),
+                              tree_balance balance = UNBALANCED);
 //    Конструктор по умолчанию
 
-    BinarySearchTree(const BinarySearchTree<T> &obj);
+    BinarySearchTree(const BinarySearchTree<T, Compare> &obj);
 //    Конструктор копирования
 
-    BinarySearchTree(const BinarySearchTree<T> &&obj) noexcept;
-//    Конструктор переноса
+    BinarySearchTree(BinarySearchTree<T, Compare> &&obj) noexcept;
+//    Конструктор переноса (за O(1), obj становится пустым)
 
     BinarySearchTree(std::initializer_list<T> &lst, tree_order order = IN_ORDER,
-                     std::function<int(T, T)> comparator = defaultCompare);
+                     Compare comparator = Compare(),
+                     tree_balance balance = UNBALANCED);
 //    Конструктор со списком инициализации
 
     ~BinarySearchTree() noexcept;
@@ -45,21 +141,146 @@ public:
     void addMany(const T *arr, size_t size);
 //    Добавить элементы из указанного массива
 
+    Iterator<T> begin() const;
+//    Итератор на первый элемент в порядке прохода дерева
+
+    Iterator<T> cbegin() const;
+//    Итератор на первый элемент в порядке прохода дерева
+
+    Iterator<T> cend() const;
+//    Итератор на фиктивный элемент, следующий за последним
+
     void clear();
 //    Очистить дерево (удалить все элементы)
 
-    bool contains(const T &elem);
+    bool contains(const T &elem) const;
 //    Проверить имеется ли указанный элемент в дереве
 
-    bool contains(const BinarySearchTree<T> &obj) const;
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const Key &key) const;
+//    Проверить имеется ли элемент, равный key другого типа (только для прозрачной функции сравнения)
+
+    bool contains(const BinarySearchTree<T, Compare> &obj) const;
 //    Проверить имеется ли указанная ветка в дереве
 
-    void copy(const BinarySearchTree<T> &obj);
-//    Делает ветку точной копией указанной ветки
+    size_t count(const T &elem) const;
+//    Количество элементов, равных указанному (0 или 1)
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    size_t count(const Key &key) const;
+//    Количество элементов, равных key другого типа (только для прозрачной функции сравнения)
+
+    size_t countRange(const T &from, const T &to) const;
+//    Количество элементов в полуинтервале [from, to)
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    size_t countRange(const Key &from, const Key &to) const;
+//    Количество элементов в полуинтервале [from, to) ключей другого типа (только для прозрачной функции сравнения)
+
+    void copy(const BinarySearchTree<T, Compare> &obj);
+//    Делает дерево точной копией указанного дерева
+
+    std::reverse_iterator<Iterator<T>> crbegin() const;
+//    Обратный итератор на последний элемент в порядке прохода дерева
+
+    std::reverse_iterator<Iterator<T>> crend() const;
+//    Обратный итератор на фиктивный элемент перед первым
+
+    BinarySearchTree<T, Compare> differenceWith(const BinarySearchTree<T, Compare> &obj) const;
+//    Разность множеств: элементы дерева, отсутствующие в obj (сбалансированное дерево за O(n + m))
+
+    template<typename... Args>
+    std::pair<Iterator<T>, bool> emplace(Args &&... args);
+//    Создать элемент из аргументов и добавить его, если такого еще нет (итератор на элемент и был ли он добавлен)
+
+    bool empty() const;
+//    Проверить на пустоту (аналог isEmpty)
 
-    void extend(const BinarySearchTree<T> &obj);
+    Iterator<T> end() const;
+//    Итератор на фиктивный элемент, следующий за последним
+
+    std::pair<Iterator<T>, Iterator<T>> equalRange(const T &elem) const;
+//    Пара итераторов по возрастанию: lowerBound(elem) и upperBound(elem)
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    std::pair<Iterator<T>, Iterator<T>> equalRange(const Key &key) const;
+//    Пара итераторов по возрастанию для key другого типа (только для прозрачной функции сравнения)
+
+    std::pair<Iterator<T>, Iterator<T>> equal_range(const T &elem) const;
+//    То же, что equalRange (для совместимости с std::set)
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    std::pair<Iterator<T>, Iterator<T>> equal_range(const Key &key) const;
+//    То же, что equalRange для key другого типа (для совместимости с std::set)
+
+    Iterator<T> erase(Iterator<T> pos);
+//    Удалить элемент по итератору без поиска (возвращает итератор на элемент, занявший его позицию)
+
+    size_t erase(const T &elem);
+//    Удалить элемент, если он есть (возвращает количество удаленных: 0 или 1)
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    size_t erase(const Key &key);
+//    Удалить элемент, равный key другого типа (только для прозрачной функции сравнения)
+
+    void extend(const BinarySearchTree<T, Compare> &obj);
 //    Расширить дерево, путем сложения его с данным
 
+    FrozenBinarySearchTree<T, Compare> freeze() const;
+//    Построить неизменяемую копию дерева в компактном массиве для быстрого поиска (за O(n))
+
+    template<typename ForwardIt>
+    static BinarySearchTree<T, Compare> fromSorted(ForwardIt first, ForwardIt last, tree_order order = IN_ORDER,
+                                                   Compare comparator = Compare(),
+                                                   tree_balance balance = UNBALANCED);
+//    Построить идеально сбалансированное дерево из отсортированных элементов за O(n)
+//    (повторяющиеся элементы пропускаются)
+
+    template<typename InputIt>
+    static BinarySearchTree<T, Compare> fromUnsorted(InputIt first, InputIt last, tree_order order = IN_ORDER,
+                                                     Compare comparator = Compare(),
+                                                     tree_balance balance = UNBALANCED);
+//    Построить идеально сбалансированное дерево из произвольных элементов за O(n log n)
+//    (повторяющиеся элементы пропускаются)
+
+    Iterator<T> find(const T &elem) const;
+//    Итератор на элемент, равный указанному (или на фиктивный элемент, если такого нет)
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    Iterator<T> find(const Key &key) const;
+//    Итератор на элемент, равный key другого типа, или на фиктивный элемент (только для прозрачной функции сравнения)
+
+    template<typename Visitor>
+    void forEachBatch(size_t batch_size, Visitor visitor) const;
+//    Передать элементы в порядке прохода дерева порциями до batch_size элементов: visitor(const T *batch, size_t size)
+
+    template<typename Visitor>
+    void forEachBatch(size_t batch_size, tree_order order, Visitor visitor) const;
+//    Передать элементы в указанном порядке прохода порциями до batch_size элементов
+
+    template<typename Visitor>
+    void forEachInRange(const T &from, const T &to, Visitor visitor) const;
+//    Вызвать visitor для каждого элемента полуинтервала [from, to) по возрастанию
+
+    std::pair<Iterator<T>, bool> insert(const T &elem);
+//    Добавить элемент, если его еще нет (итератор на элемент и был ли он добавлен)
+
+    std::pair<Iterator<T>, bool> insert(T &&elem);
+//    Добавить элемент переносом, если его еще нет
+
+    Iterator<T> insert(Iterator<T> hint, const T &elem);
+//    Добавить элемент рядом с подсказкой hint (перед ней или после нее) без спуска от корня, если он туда попадает
+
+    Iterator<T> insert(Iterator<T> hint, T &&elem);
+//    Добавить элемент переносом рядом с подсказкой hint
+
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last);
+//    Добавить элементы диапазона, пропуская имеющиеся
+
+    BinarySearchTree<T, Compare> intersectionWith(const BinarySearchTree<T, Compare> &obj) const;
+//    Пересечение множеств (сбалансированное дерево за O(n + m))
+
     bool isEmpty() const;
 //    Проверить на пустоту
 
@@ -69,580 +290,1794 @@ public:
     std::unique_ptr<Iterator<T>> iteratorEnd() const;
 //    Получить итератор на фиктивный элемент, следующий за последним
 
-    T max();
+    Compare key_comp() const;
+//    Получить копию компаратора дерева
+
+    static BinarySearchTree<T, Compare> load(const std::string &path, tree_order order = IN_ORDER,
+                                             Compare comparator = Compare(), tree_balance balance = UNBALANCED);
+//    Загрузить дерево из файла, записанного save, построив сбалансированное дерево за O(n)
+
+    Iterator<T> lowerBound(const T &elem) const;
+//    Итератор по возрастанию на первый элемент, не меньший указанного
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    Iterator<T> lowerBound(const Key &key) const;
+//    Итератор по возрастанию на первый элемент, не меньший key другого типа (только для прозрачной функции сравнения)
+
+    Iterator<T> lower_bound(const T &elem) const;
+//    То же, что lowerBound (для совместимости с std::set)
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    Iterator<T> lower_bound(const Key &key) const;
+//    То же, что lowerBound для key другого типа (для совместимости с std::set)
+
+    T max() const;
 //    Вернуть максимальный элемент
 
-    T min();
+    T min() const;
 //    Вернуть минимальный элемент
 
+    T nth(size_t k) const;
+//    Вернуть k-й по возрастанию элемент (начиная с 0)
+
+    size_t rank(const T &elem) const;
+//    Количество элементов, меньших указанного
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    size_t rank(const Key &key) const;
+//    Количество элементов, меньших key другого типа (только для прозрачной функции сравнения)
+
+    std::reverse_iterator<Iterator<T>> rbegin() const;
+//    Обратный итератор на последний элемент в порядке прохода дерева
+
+    std::reverse_iterator<Iterator<T>> rend() const;
+//    Обратный итератор на фиктивный элемент перед первым
+
     void remove(const T &elem);
 //    Удалить элемент
 
     void removeMany(const T *arr, size_t size);
 //    Удалить элементы из указанного массива
 
-    void setComparator(std::function<int(T, T)> comparator);
+    Iterator<T> upperBound(const T &elem) const;
+//    Итератор по возрастанию на первый элемент, больший указанного
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    Iterator<T> upperBound(const Key &key) const;
+//    Итератор по возрастанию на первый элемент, больший key другого типа (только для прозрачной функции сравнения)
+
+    Iterator<T> upper_bound(const T &elem) const;
+//    То же, что upperBound (для совместимости с std::set)
+
+    template<typename Key, typename C = Compare, typename = typename C::is_transparent>
+    Iterator<T> upper_bound(const Key &key) const;
+//    То же, что upperBound для key другого типа (для совместимости с std::set)
+
+    void save(const std::string &path) const;
+//    Записать элементы в файл по возрастанию в двоичном виде (запись элементов задает BSTSerializer<T>)
+
+    void setBalance(tree_balance balance);
+//    Смена политики балансировки (при переходе на AVL дерево перестраивается за O(n))
+
+    void setComparator(Compare comparator);
 //    Смена функции сравнения
 
     void setOrder(tree_order order);
 //    Смена порядка прохода по дереву
 
+    void setParallelism(size_t threads, size_t serial_threshold = default_serial_threshold_);
+//    Задать число потоков массовых операций (0 - по числу ядер) и размер, до которого они выполняются последовательно
+
     size_t size() const;
 //    Количество элементов в дереве
 
+    BinarySearchTree<T, Compare> symmetricDifferenceWith(const BinarySearchTree<T, Compare> &obj) const;
+//    Симметрическая разность множеств (сбалансированное дерево за O(n + m))
+
     T *toArray() const;
-//    Конвертировать ветку в массив
+//    Конвертировать дерево в массив
+
+    size_t toArray(T *buffer, size_t capacity, size_t offset = 0) const;
+//    Записать в buffer до capacity элементов в порядке прохода, начиная с offset-го (возвращает количество записанных)
+
+    template<typename OutputIt>
+    OutputIt toArray(OutputIt out) const;
+//    Записать все элементы в порядке прохода через итератор вывода (возвращает итератор после последнего)
+
+    bool tryAdd(const T &elem);
+//    Добавить элемент без исключений (false, если элемент уже есть)
+
+    size_t tryAddMany(const T *arr, size_t size, bool *applied = nullptr);
+//    Добавить элементы из массива без исключений, вернуть количество добавленных
+//    (applied[i] - был ли добавлен arr[i], если applied указан)
+
+    bool tryRemove(const T &elem);
+//    Удалить элемент без исключений (false, если элемента нет)
+
+    size_t tryRemoveMany(const T *arr, size_t size, bool *applied = nullptr);
+//    Удалить элементы из массива без исключений, вернуть количество удаленных
+//    (applied[i] - был ли удален arr[i], если applied указан)
 
-    BinarySearchTree<T> &operator=(const BinarySearchTree<T> &obj);
+    BinarySearchTree<T, Compare> unionWith(const BinarySearchTree<T, Compare> &obj) const;
+//    Объединение множеств (сбалансированное дерево за O(n + m))
+
+    BinarySearchTree<T, Compare> &operator=(const BinarySearchTree<T, Compare> &obj);
 //    Перегрузка оператора присваивания
 
-    BinarySearchTree<T> &operator+=(const BinarySearchTree<T> &obj);
+    BinarySearchTree<T, Compare> &operator=(BinarySearchTree<T, Compare> &&obj) noexcept;
+//    Перегрузка оператора присваивания с переносом (за O(1), obj становится пустым)
+
+    BinarySearchTree<T, Compare> &operator+=(const BinarySearchTree<T, Compare> &obj);
 //    Сложение с другим деревом (аналогично extend), результат сложения в this
 
-    template<typename _T>
-    friend BinarySearchTree<_T>
-    operator+(const BinarySearchTree<_T> &obj1, const BinarySearchTree<_T> &obj2);
+    template<typename _T, typename _Compare>
+    friend BinarySearchTree<_T, _Compare>
+    operator+(const BinarySearchTree<_T, _Compare> &obj1, const BinarySearchTree<_T, _Compare> &obj2);
 //    Сложение с другим деревом (аналогично extend)
 
-    template<typename _T>
-    friend std::ostream &operator<<(std::ostream &os, const BinarySearchTree<_T> &obj);
+    template<typename _T, typename _Compare>
+    friend std::ostream &operator<<(std::ostream &os, const BinarySearchTree<_T, _Compare> &obj);
 //    Перегрузка оператора вывода на поток
 
-    template<typename _T>
-    friend bool operator==(const BinarySearchTree<_T> &obj1, const BinarySearchTree<_T> &obj2);
+    template<typename _T, typename _Compare>
+    friend bool operator==(const BinarySearchTree<_T, _Compare> &obj1, const BinarySearchTree<_T, _Compare> &obj2);
 //    Перегрузка оператора равенства
 
-    template<typename _T>
-    friend bool operator!=(const BinarySearchTree<_T> &obj1, const BinarySearchTree <_T> &obj2);
+    template<typename _T, typename _Compare>
+    friend bool operator!=(const BinarySearchTree<_T, _Compare> &obj1, const BinarySearchTree<_T, _Compare> &obj2);
 //    Перегрузка оператора неравенства
 
 private:
-    void addToArray(T *arr, size_t *current_size) const;
-//    Добавить ветку в массив
+    template<typename>
+    friend class Iterator;
 
-    void dealloc();
-//    Освободить память всей текущей ветки
+    using Node = BSTNode<T>;
 
-    static int defaultCompare(T a, T b);
-//    Функция сравнения элементов по умолчанию
+    void addToArray(T *arr) const;
+//    Записать элементы дерева в массив в порядке прохода
+
+    template<typename RandomIt>
+    void build(RandomIt first, size_t size);
+//    Построить пустому дереву идеально сбалансированную форму из size отсортированных различных элементов
+
+    template<typename RandomIt>
+    Node *buildBranch(RandomIt first, size_t size, Node *block, Node *parent);
+//    Построить идеально сбалансированную ветку из size отсортированных элементов (i-й элемент в block[i])
+
+    template<typename RandomIt>
+    Node *buildBranchParallel(RandomIt first, size_t size, Node *block);
+//    Построить идеально сбалансированное дерево, достраивая нижние ветки параллельно
+
+    static size_t countOf(const Node *node);
+//    Количество элементов в ветке (0 для отсутствующей ветки)
+
+    template<typename A, typename B>
+    int compare(const A &a, const B &b) const;
+//    Сравнить элементы функцией сравнения дерева (отрицательное, 0 или положительное)
+
+    template<typename A, typename B>
+    bool less(const A &a, const B &b) const;
+//    Меньше ли a, чем b, по функции сравнения дерева (ровно один вызов функции сравнения)
+
+    bool containsBranch(const Node *branch) const;
+//    Проверить, совпадает ли одна из веток дерева с веткой branch
+
+    Node *copyBranch(const Node *branch, Node *parent);
+//    Создать копию ветки той же формы с указанным родителем (без сравнений элементов)
+
+    Node *copyTreeParallel(const Node *root);
+//    Создать копию дерева той же формы параллельно (i-й по возрастанию элемент в i-м слоте блока)
 
-    BinarySearchTree<T> *find(const T &elem);
+    void dealloc(Node *node);
+//    Освободить память всей ветки
+
+    template<typename Key>
+    Node *descend(const Key &key, Node *&parent, bool &smaller) const;
+//    Спуститься по дереву к key: вернуть равный узел или nullptr и место вставки (parent, smaller)
+
+    template<typename Key>
+    Node *findNode(const Key &key) const;
 //    Найти элемент со значением равным указанному
 
-    bool isGreaterChild() const;
-//    Является ли текущий элемент большим по отношению к родителю
+    template<typename Value>
+    Node *attachNode(Node *parent, bool smaller, Value &&elem);
+//    Создать узел потомком parent (корнем, если parent == nullptr) и восстановить баланс
+
+    template<typename Value>
+    Node *insertNode(Value &&elem, bool &inserted);
+//    Добавить элемент, если его еще нет, и вернуть его узел (inserted - был ли он добавлен)
+
+    template<typename Value>
+    Node *insertNodeNear(const Node *hint, Value &&elem, bool &inserted);
+//    Добавить элемент рядом с узлом hint (nullptr - после максимального), если он попадает между соседями hint
+
+    template<typename Key>
+    Iterator<T> bound(const Key &key, bool upper) const;
+//    Итератор по возрастанию на первый элемент, не меньший (upper = false) или больший (upper = true) указанного
+
+    template<typename Key>
+    size_t countSmaller(const Key &key) const;
+//    Количество элементов, меньших указанного
+
+    static bool isGreaterChild(const Node *node);
+//    Является ли элемент большим по отношению к родителю
+
+    static bool isSmallerChild(const Node *node);
+//    Является ли элемент меньшим по отношению к родителю
+
+    static bool isRoot(const Node *node);
+//    Является ли элемент корнем
+
+    static int heightOfSize(size_t size);
+//    Высота идеально сбалансированной ветки из size элементов
+
+    static Node *maxElement(Node *node);
+//    Найти в ветке элемент с максимальным значением
+
+    static Node *minElement(Node *node);
+//    Найти в ветке элемент с минимальным значением
+
+    BinarySearchTree<T, Compare> merge(const BinarySearchTree<T, Compare> &obj, bool take_this_only,
+                                       bool take_both, bool take_obj_only) const;
+//    Слияние двух деревьев в порядке возрастания: в результат попадают элементы только
+//    этого дерева, общие элементы и элементы только obj в соответствии с флагами
+
+    static const Node *nthElement(const Node *node, size_t k);
+//    Найти в ветке k-й по возрастанию элемент
+
+    static int balanceFactor(const Node *node);
+//    Разность высот меньшей и большей веток
 
-    bool isSmallerChild() const;
-//    Является ли текущий элемент меньшим по отношению к родителю
+    bool preferRebuild(size_t count) const;
+//    Дешевле ли перестроить AVL-дерево слиянием, чем изменить count элементов по одному
 
-    bool isRoot() const;
-//    Является ли текущая ветка корнем
+    size_t rebuild(const T *arr, size_t size, bool remove);
+//    Перестроить дерево слиянием с отсортированным массивом (добавить или удалить его элементы),
+//    вернуть количество добавленных или удаленных элементов
 
-    BinarySearchTree<T> *maxElement();
-//    Найти элемент с максимальным значением
+    Node *rebalance(Node *node);
+//    Восстановить баланс ветки (для AVL), вернуть новый корень ветки
 
-    BinarySearchTree<T> *minElement();
-//    Найти элемент с минимальным значением
+    void replaceChild(Node *parent, Node *old_child, Node *new_child);
+//    Заменить потомка родителя (или корень дерева) на другую ветку
 
-    BinarySearchTree<T> *parent_; // root.parent_ == nullptr
-    BinarySearchTree<T> *smaller_child_;
-    BinarySearchTree<T> *greater_child_;
-    T value_;
+    Node *rotateSmaller(Node *node);
+//    Поворот в сторону меньшей ветки (левый поворот), вернуть новый корень ветки
 
-    bool empty_;
+    Node *rotateGreater(Node *node);
+//    Поворот в сторону большей ветки (правый поворот), вернуть новый корень ветки
+
+    void removeNode(Node *node);
+//    Удалить узел (элемент с двумя потомками сначала меняется местами с соседним по значению,
+//    значения не перемещаются, поэтому итераторы на другие элементы остаются действительными)
+
+    void swapPositions(Node *node, Node *descendant);
+//    Поменять местами в дереве узел и его потомка (ссылки, размеры веток и высоты)
+
+    void unlink(Node *node);
+//    Удалить элемент, имеющий не более одного потомка
+
+    static void updateNode(Node *node);
+//    Пересчитать высоту и количество элементов ветки по потомкам
+
+    static int heightOf(const Node *node);
+//    Высота ветки (0 для отсутствующей ветки)
+
+    size_t threadsFor(size_t count) const;
+//    Число потоков для массовой операции над count элементами
+
+    Node *root_;
+    NodePool<Node> pool_;
 
     tree_order order_;
-    std::function<int(T, T)> comparator_;
+    tree_balance balance_;
+    Compare comparator_;
+
+    size_t threads_;
+    size_t serial_threshold_;
+
+    static constexpr size_t default_serial_threshold_ = 100000;
+    static constexpr size_t tasks_per_thread_ = 4;
+    static constexpr bool three_way_ =
+            !std::is_same<std::invoke_result_t<const Compare &, const T &, const T &>, bool>::value;
 };
 
 
-template<typename T>
-BinarySearchTree<T>::BinarySearchTree(tree_order order, std::function<int(T, T)> comparator) {
-    parent_ = nullptr;
-    smaller_child_ = nullptr;
-    greater_child_ = nullptr;
-    empty_ = true;
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare>::BinarySearchTree(tree_order order, Compare comparator,
+                                               tree_balance balance) {
+    root_ = nullptr;
     order_ = order;
+    balance_ = balance;
     comparator_ = comparator;
+    threads_ = 1;
+    serial_threshold_ = default_serial_threshold_;
 }
 
-template<typename T>
-BinarySearchTree<T>::BinarySearchTree(const BinarySearchTree<T> &obj) {
-    parent_ = nullptr;
-    smaller_child_ = nullptr;
-    greater_child_ = nullptr;
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare>::BinarySearchTree(const BinarySearchTree<T, Compare> &obj) {
+    root_ = nullptr;
     copy(obj);
 }
 
-template<typename T>
-BinarySearchTree<T>::BinarySearchTree(const BinarySearchTree<T> &&obj) noexcept {
-    parent_ = nullptr;
-    smaller_child_ = nullptr;
-    greater_child_ = nullptr;
-    copy(obj);
-    obj.~BinarySearchTree();
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare>::BinarySearchTree(BinarySearchTree<T, Compare> &&obj) noexcept {
+    root_ = obj.root_;
+    pool_ = std::move(obj.pool_);
+    order_ = obj.order_;
+    balance_ = obj.balance_;
+    comparator_ = obj.comparator_;
+    threads_ = obj.threads_;
+    serial_threshold_ = obj.serial_threshold_;
+    obj.root_ = nullptr;
 }
 
-template<typename T>
-BinarySearchTree<T>::BinarySearchTree(std::initializer_list<T> &lst, tree_order order,
-                                      std::function<int(T, T)> comparator) {
-    empty_ = true;
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare>::BinarySearchTree(std::initializer_list<T> &lst, tree_order order,
+                                               Compare comparator, tree_balance balance) {
+    root_ = nullptr;
     order_ = order;
+    balance_ = balance;
     comparator_ = comparator;
+    threads_ = 1;
+    serial_threshold_ = default_serial_threshold_;
+    // повторы проверяются до создания узлов, чтобы исключение не оставляло частично построенное дерево
+    std::vector<T> values(lst.begin(), lst.end());
+    std::sort(values.begin(), values.end(), [this](const T &a, const T &b) {
+        return less(a, b);
+    });
+    if (std::adjacent_find(values.begin(), values.end(), [this](const T &a, const T &b) {
+        return !less(a, b);
+    }) != values.end()) {
+        throw BSTDuplicateValueException("duplicate values to add");
+    }
+    if (balance_ == AVL) {
+        build(values.begin(), values.size());
+        return;
+    }
     for (auto el : lst) {
         add(el);
     }
 }
 
-template<typename T>
-BinarySearchTree<T>::~BinarySearchTree() noexcept {
-    dealloc();
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare>::~BinarySearchTree() noexcept {
+    clear();
 }
 
-template<typename T>
-void BinarySearchTree<T>::add(const T &elem) {
-    if (empty_) {
-        empty_ = false;
-        value_ = elem;
-        return;
-    }
-    if (!comparator_(elem, value_)) {
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::add(const T &elem) {
+    if (!tryAdd(elem)) {
         throw BSTDuplicateValueException("duplicate value to add");
     }
-    if (comparator_(elem, value_) < 0) {
-        if (!smaller_child_) {
-            smaller_child_ = new BinarySearchTree(order_, comparator_);
-            smaller_child_->parent_ = this;
-        }
-        smaller_child_->add(elem);
-    } else {
-        if (!greater_child_) {
-            greater_child_ = new BinarySearchTree(order_, comparator_);
-            greater_child_->parent_ = this;
-        }
-        greater_child_->add(elem);
-    }
 }
 
-template<typename T>
-void BinarySearchTree<T>::addMany(const T *arr, size_t size) {
-    bool duplicates = false;
-    for (size_t i = 0; i < size; i++) {
-        try {
-            add(arr[i]);
-        } catch (BSTDuplicateValueException &err) {
-            duplicates = true;
-        }
-    }
-    if (duplicates) {
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::addMany(const T *arr, size_t size) {
+    size_t added = preferRebuild(size) ? rebuild(arr, size, false) : tryAddMany(arr, size);
+    if (added != size) {
         throw BSTDuplicateValueException("duplicate values to add");
     }
 }
 
-template<typename T>
-void BinarySearchTree<T>::clear() {
-    dealloc();
-    empty_ = true;
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::begin() const {
+    return Iterator<T>(*this);
 }
 
-template<typename T>
-bool BinarySearchTree<T>::contains(const T &elem) {
-    return (bool) find(elem);
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::cbegin() const {
+    return begin();
 }
 
-template<typename T>
-bool BinarySearchTree<T>::contains(const BinarySearchTree<T> &obj) const {
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::cend() const {
+    return end();
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::clear() {
+    if constexpr (!std::is_trivially_destructible<T>::value) {
+        dealloc(root_);
+    }
+    root_ = nullptr;
+    pool_.clear();
+}
+
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::contains(const T &elem) const {
+    return (bool) findNode(elem);
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+bool BinarySearchTree<T, Compare>::contains(const Key &key) const {
+    return (bool) findNode(key);
+}
+
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::contains(const BinarySearchTree<T, Compare> &obj) const {
     if (obj.isEmpty()) {
         throw BSTEmptyException("can't check empty tree presence");
     }
-    bool existence = (value_ == obj.value_);
-    if (smaller_child_) {
-        if (existence && obj.smaller_child_) {
-            existence = smaller_child_->contains(*obj.smaller_child_);
-        } else if (!existence) {
-            existence = smaller_child_->contains(obj);
-        }
+    if (isEmpty()) {
+        return false;
     }
-    if (greater_child_) {
-        if (existence && obj.greater_child_) {
-            existence = greater_child_->contains(*obj.greater_child_);
-        } else if (!existence) {
-            existence = greater_child_->contains(obj);
-        }
+    return containsBranch(obj.root_);
+}
+
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::count(const T &elem) const {
+    return contains(elem) ? 1 : 0;
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+size_t BinarySearchTree<T, Compare>::count(const Key &key) const {
+    return findNode(key) ? 1 : 0;
+}
+
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::countRange(const T &from, const T &to) const {
+    if (!less(from, to)) {
+        return 0;
     }
-    return existence;
+    return rank(to) - rank(from);
 }
 
-template<typename T>
-void BinarySearchTree<T>::copy(const BinarySearchTree<T> &obj) {
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+size_t BinarySearchTree<T, Compare>::countRange(const Key &from, const Key &to) const {
+    if (!less(from, to)) {
+        return 0;
+    }
+    return countSmaller(to) - countSmaller(from);
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::copy(const BinarySearchTree<T, Compare> &obj) {
+    if (this == &obj) {
+        return;
+    }
     clear();
     order_ = obj.order_;
+    balance_ = obj.balance_;
     comparator_ = obj.comparator_;
+    threads_ = obj.threads_;
+    serial_threshold_ = obj.serial_threshold_;
 
-    if (!obj.isEmpty()) {
-        value_ = obj.value_;
-        if (obj.smaller_child_) {
-            add(obj.smaller_child_->value_);
-            smaller_child_->copy(*obj.smaller_child_);
-        }
-        if (obj.greater_child_) {
-            add(obj.greater_child_->value_);
-            greater_child_->copy(*obj.greater_child_);
-        }
+    if (!obj.root_) {
+        return;
+    }
+    if (threadsFor(obj.size()) > 1) {
+        root_ = copyTreeParallel(obj.root_);
+        return;
     }
+    pool_.reserve(obj.size());
+    root_ = copyBranch(obj.root_, nullptr);
 }
 
-template<typename T>
-void BinarySearchTree<T>::extend(const BinarySearchTree<T> &obj) {
+template<typename T, typename Compare>
+std::reverse_iterator<Iterator<T>> BinarySearchTree<T, Compare>::crbegin() const {
+    return rbegin();
+}
+
+template<typename T, typename Compare>
+std::reverse_iterator<Iterator<T>> BinarySearchTree<T, Compare>::crend() const {
+    return rend();
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> BinarySearchTree<T, Compare>::differenceWith(const BinarySearchTree<T, Compare> &obj) const {
+    return merge(obj, true, false, false);
+}
+
+template<typename T, typename Compare>
+template<typename... Args>
+std::pair<Iterator<T>, bool> BinarySearchTree<T, Compare>::emplace(Args &&... args) {
+    return insert(T(std::forward<Args>(args)...));
+}
+
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::empty() const {
+    return isEmpty();
+}
+
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::end() const {
+    return Iterator<T>(&root_, nullptr, order_);
+}
+
+template<typename T, typename Compare>
+std::pair<Iterator<T>, Iterator<T>> BinarySearchTree<T, Compare>::equalRange(const T &elem) const {
+    return {bound(elem, false), bound(elem, true)};
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+std::pair<Iterator<T>, Iterator<T>> BinarySearchTree<T, Compare>::equalRange(const Key &key) const {
+    return {bound(key, false), bound(key, true)};
+}
+
+template<typename T, typename Compare>
+std::pair<Iterator<T>, Iterator<T>> BinarySearchTree<T, Compare>::equal_range(const T &elem) const {
+    return equalRange(elem);
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+std::pair<Iterator<T>, Iterator<T>> BinarySearchTree<T, Compare>::equal_range(const Key &key) const {
+    return equalRange(key);
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::extend(const BinarySearchTree<T, Compare> &obj) {
     if (obj.isEmpty()) {
         throw BSTEmptyException("empty tree to extend by");
     }
-    for (auto it = *obj.iteratorBegin(); it < *obj.iteratorEnd(); it++) {
-        try {
-            add(*it);
-        } catch (BSTDuplicateValueException &err) {}
+    if (preferRebuild(obj.size())) {
+        *this = unionWith(obj);
+        return;
+    }
+    // форма несбалансированного дерева задается порядком добавления (от нее зависят прямой и обратный обходы),
+    // поэтому оно намеренно не перестраивается слиянием и расширяется по одному элементу
+    for (Iterator<T> it(obj); !it.isEnd(); it.next()) {
+        tryAdd(it.value());
     }
 }
 
-template<typename T>
-bool BinarySearchTree<T>::isEmpty() const {
-    return empty_;
+template<typename T, typename Compare>
+FrozenBinarySearchTree<T, Compare> BinarySearchTree<T, Compare>::freeze() const {
+    return FrozenBinarySearchTree<T, Compare>(Iterator<T>(*this, IN_ORDER), size(), comparator_);
 }
 
-template<typename T>
-std::unique_ptr<Iterator<T>> BinarySearchTree<T>::iteratorBegin() const {
+template<typename T, typename Compare>
+template<typename ForwardIt>
+BinarySearchTree<T, Compare> BinarySearchTree<T, Compare>::fromSorted(ForwardIt first, ForwardIt last,
+                                                                      tree_order order, Compare comparator,
+                                                                      tree_balance balance) {
+    BinarySearchTree<T, Compare> tree(order, comparator, balance);
+    size_t size = 0;
+    bool duplicates = false;
+    for (ForwardIt it = first, previous = first; it != last; previous = it, ++it) {
+        int comparison = (it == first) ? -1 : tree.compare(*previous, *it);
+        if (comparison > 0) {
+            throw BSTUnsortedValuesException("values to build from are not sorted");
+        }
+        if (!comparison) {
+            duplicates = true;
+        } else {
+            size++;
+        }
+    }
+
+    using category = typename std::iterator_traits<ForwardIt>::iterator_category;
+    if constexpr (std::is_base_of<std::random_access_iterator_tag, category>::value) {
+        if (!duplicates) {
+            tree.build(first, size);
+            return tree;
+        }
+    }
+    std::vector<std::reference_wrapper<const T>> distinct;
+    distinct.reserve(size);
+    for (ForwardIt it = first; it != last; ++it) {
+        if (distinct.empty() || tree.less(distinct.back().get(), *it)) {
+            distinct.push_back(*it);
+        }
+    }
+    tree.build(distinct.begin(), size);
+    return tree;
+}
+
+template<typename T, typename Compare>
+template<typename InputIt>
+BinarySearchTree<T, Compare> BinarySearchTree<T, Compare>::fromUnsorted(InputIt first, InputIt last,
+                                                                        tree_order order, Compare comparator,
+                                                                        tree_balance balance) {
+    BinarySearchTree<T, Compare> tree(order, comparator, balance);
+    std::vector<T> values(first, last);
+    parallelSort(values.begin(), values.end(), [&tree](const T &a, const T &b) {
+        return tree.less(a, b);
+    }, tree.threadsFor(values.size()));
+    values.erase(std::unique(values.begin(), values.end(), [&tree](const T &a, const T &b) {
+        return !tree.less(a, b);
+    }), values.end());
+
+    tree.build(values.begin(), values.size());
+    return tree;
+}
+
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::erase(Iterator<T> pos) {
+    if (pos.isEnd()) {
+        throw BSTIteratorAccessingEndValueException("end value to erase");
+    }
+    // по возрастанию (убыванию) следующий элемент находится по ссылкам заранее и не меняет узел при удалении,
+    // в прямом и обратном порядках форма дерева меняется, и элемент на той же позиции выбирается по рангу
+    Node *node = const_cast<Node *>(pos.node_);
+    if (pos.order_ == IN_ORDER || pos.order_ == REVERSE_ORDER) {
+        const Node *next = pos.nextNode(node);
+        removeNode(node);
+        return Iterator<T>(&root_, next, pos.order_);
+    }
+    size_t position = pos.position();
+    removeNode(node);
+    Iterator<T> result(&root_, nullptr, pos.order_);
+    result.node_ = result.nodeAt(position);
+    return result;
+}
+
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::erase(const T &elem) {
+    return tryRemove(elem) ? 1 : 0;
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+size_t BinarySearchTree<T, Compare>::erase(const Key &key) {
+    Node *found = findNode(key);
+    if (!found) {
+        return 0;
+    }
+    removeNode(found);
+    return 1;
+}
+
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::find(const T &elem) const {
+    return Iterator<T>(&root_, findNode(elem), order_);
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+Iterator<T> BinarySearchTree<T, Compare>::find(const Key &key) const {
+    return Iterator<T>(&root_, findNode(key), order_);
+}
+
+template<typename T, typename Compare>
+template<typename Visitor>
+void BinarySearchTree<T, Compare>::forEachBatch(size_t batch_size, Visitor visitor) const {
+    forEachBatch(batch_size, order_, visitor);
+}
+
+// Дополнительная память - одна порция, независимо от размера дерева
+template<typename T, typename Compare>
+template<typename Visitor>
+void BinarySearchTree<T, Compare>::forEachBatch(size_t batch_size, tree_order order, Visitor visitor) const {
+    if (!batch_size) {
+        throw BSTOutOfRangeException("batch size must be positive");
+    }
+    std::vector<T> batch;
+    batch.reserve(std::min(batch_size, size()));
+    for (Iterator<T> it(*this, order); !it.isEnd(); it.next()) {
+        batch.push_back(it.value());
+        if (batch.size() == batch_size) {
+            visitor(static_cast<const T *>(batch.data()), batch.size());
+            batch.clear();
+        }
+    }
+    if (!batch.empty()) {
+        visitor(static_cast<const T *>(batch.data()), batch.size());
+    }
+}
+
+template<typename T, typename Compare>
+template<typename Visitor>
+void BinarySearchTree<T, Compare>::forEachInRange(const T &from, const T &to, Visitor visitor) const {
+    for (Iterator<T> it = bound(from, false); !it.isEnd() && less(it.value(), to); it.next()) {
+        visitor(it.value());
+    }
+}
+
+template<typename T, typename Compare>
+std::pair<Iterator<T>, bool> BinarySearchTree<T, Compare>::insert(const T &elem) {
+    bool inserted = false;
+    const Node *node = insertNode(elem, inserted);
+    return {Iterator<T>(&root_, node, order_), inserted};
+}
+
+template<typename T, typename Compare>
+std::pair<Iterator<T>, bool> BinarySearchTree<T, Compare>::insert(T &&elem) {
+    bool inserted = false;
+    const Node *node = insertNode(std::move(elem), inserted);
+    return {Iterator<T>(&root_, node, order_), inserted};
+}
+
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::insert(Iterator<T> hint, const T &elem) {
+    bool inserted = false;
+    return Iterator<T>(&root_, insertNodeNear(hint.node_, elem, inserted), order_);
+}
+
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::insert(Iterator<T> hint, T &&elem) {
+    bool inserted = false;
+    return Iterator<T>(&root_, insertNodeNear(hint.node_, std::move(elem), inserted), order_);
+}
+
+template<typename T, typename Compare>
+template<typename InputIt>
+void BinarySearchTree<T, Compare>::insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+        tryAdd(*first);
+    }
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> BinarySearchTree<T, Compare>::intersectionWith(const BinarySearchTree<T, Compare> &obj) const {
+    return merge(obj, false, true, false);
+}
+
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::isEmpty() const {
+    return !root_;
+}
+
+template<typename T, typename Compare>
+std::unique_ptr<Iterator<T>> BinarySearchTree<T, Compare>::iteratorBegin() const {
     auto it = std::make_unique<Iterator<T>>(*this);
     it->begin();
     return it;
 }
 
-template<typename T>
-std::unique_ptr<Iterator<T>> BinarySearchTree<T>::iteratorEnd() const {
+template<typename T, typename Compare>
+std::unique_ptr<Iterator<T>> BinarySearchTree<T, Compare>::iteratorEnd() const {
     auto it = std::make_unique<Iterator<T>>(*this);
     it->end();
     return it;
 }
 
-template<typename T>
-T BinarySearchTree<T>::max() {
+template<typename T, typename Compare>
+Compare BinarySearchTree<T, Compare>::key_comp() const {
+    return comparator_;
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> BinarySearchTree<T, Compare>::load(const std::string &path, tree_order order,
+                                                                Compare comparator, tree_balance balance) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw BSTFileException("can't open file " + path);
+    }
+    BSTFileHeader header;
+    BSTFile::readHeader(file, header);
+    BSTFile::checkHeader(header, SORTED_LAYOUT, sizeof(T));
+
+    // память растет по мере чтения, а не по количеству из заголовка, чтобы не доверять поврежденному файлу
+    std::vector<T> values;
+    while (values.size() < header.count) {
+        size_t batch = std::min<uint64_t>(BSTFile::batch_size, header.count - values.size());
+        values.resize(values.size() + batch);
+        BSTSerializer<T>::read(file, values.data() + values.size() - batch, batch);
+        if (!file) {
+            throw BSTFileException("truncated file " + path);
+        }
+    }
+    return fromSorted(values.begin(), values.end(), order, comparator, balance);
+}
+
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::lowerBound(const T &elem) const {
+    return bound(elem, false);
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+Iterator<T> BinarySearchTree<T, Compare>::lowerBound(const Key &key) const {
+    return bound(key, false);
+}
+
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::lower_bound(const T &elem) const {
+    return lowerBound(elem);
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+Iterator<T> BinarySearchTree<T, Compare>::lower_bound(const Key &key) const {
+    return lowerBound(key);
+}
+
+template<typename T, typename Compare>
+T BinarySearchTree<T, Compare>::max() const {
     if (isEmpty()) {
         throw BSTEmptyException("can't find empty tree max value");
     }
-    return maxElement()->value_;
+    return maxElement(root_)->value;
 }
 
-template<typename T>
-T BinarySearchTree<T>::min() {
+template<typename T, typename Compare>
+T BinarySearchTree<T, Compare>::min() const {
     if (isEmpty()) {
         throw BSTEmptyException("can't find empty tree min value");
     }
-    return minElement()->value_;
+    return minElement(root_)->value;
 }
 
-template<typename T>
-void BinarySearchTree<T>::remove(const T &elem) {
-    BinarySearchTree<T> *found = find(elem);
-    if (!found) {
+template<typename T, typename Compare>
+T BinarySearchTree<T, Compare>::nth(size_t k) const {
+    if (k >= size()) {
+        throw BSTOutOfRangeException("element index out of range");
+    }
+    return nthElement(root_, k)->value;
+}
+
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::rank(const T &elem) const {
+    return countSmaller(elem);
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+size_t BinarySearchTree<T, Compare>::rank(const Key &key) const {
+    return countSmaller(key);
+}
+
+template<typename T, typename Compare>
+std::reverse_iterator<Iterator<T>> BinarySearchTree<T, Compare>::rbegin() const {
+    return std::reverse_iterator<Iterator<T>>(end());
+}
+
+template<typename T, typename Compare>
+std::reverse_iterator<Iterator<T>> BinarySearchTree<T, Compare>::rend() const {
+    return std::reverse_iterator<Iterator<T>>(begin());
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::remove(const T &elem) {
+    if (!tryRemove(elem)) {
         throw BSTNonexistentValueException("nonexistent value to remove");
     }
+}
 
-    BinarySearchTree *successor = nullptr;
-    if (found->smaller_child_ && found->greater_child_) {
-        if (found->smaller_child_->size() > found->greater_child_->size()) {
-            successor = found->smaller_child_->maxElement();
-        } else {
-            successor = found->greater_child_->minElement();
-        }
-        T successor_value = successor->value_;
-        remove(successor_value);
-        found->value_ = successor_value;
-        return;
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::removeMany(const T *arr, size_t size) {
+    size_t removed = preferRebuild(size) ? rebuild(arr, size, true) : tryRemoveMany(arr, size);
+    if (removed != size) {
+        throw BSTNonexistentValueException("nonexistent values to remove");
+    }
+}
+
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::upperBound(const T &elem) const {
+    return bound(elem, true);
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+Iterator<T> BinarySearchTree<T, Compare>::upperBound(const Key &key) const {
+    return bound(key, true);
+}
+
+template<typename T, typename Compare>
+Iterator<T> BinarySearchTree<T, Compare>::upper_bound(const T &elem) const {
+    return upperBound(elem);
+}
+
+template<typename T, typename Compare>
+template<typename Key, typename C, typename>
+Iterator<T> BinarySearchTree<T, Compare>::upper_bound(const Key &key) const {
+    return upperBound(key);
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::save(const std::string &path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    BSTFile::writeHeader(file, BSTFile::makeHeader(SORTED_LAYOUT, sizeof(T), size()));
+    forEachBatch(BSTFile::batch_size, IN_ORDER, [&file](const T *batch, size_t size) {
+        BSTSerializer<T>::write(file, batch, size);
+    });
+    if (!file.flush()) {
+        throw BSTFileException("can't write file " + path);
+    }
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::setBalance(tree_balance balance) {
+    bool unbalanced = balance_ != AVL;
+    balance_ = balance;
+    if (balance_ == AVL && unbalanced && root_) {
+        rebuild(nullptr, 0, false);
+    }
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::setComparator(Compare comparator) {
+    comparator_ = comparator;
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::setOrder(tree_order order) {
+    order_ = order;
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::setParallelism(size_t threads, size_t serial_threshold) {
+    threads_ = threads ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+    serial_threshold_ = serial_threshold;
+}
+
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::size() const {
+    return countOf(root_);
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> BinarySearchTree<T, Compare>::symmetricDifferenceWith(const BinarySearchTree<T, Compare> &obj) const {
+    return merge(obj, true, false, true);
+}
+
+template<typename T, typename Compare>
+T *BinarySearchTree<T, Compare>::toArray() const {
+    if (isEmpty()) {
+        throw BSTEmptyException("can't convert empty tree");
     }
+    T *arr = new T[size()];
+    addToArray(arr);
+    return arr;
+}
 
-    if (found->smaller_child_ && !found->greater_child_) {
-        successor = found->smaller_child_;
-        found->smaller_child_ = nullptr;
-        successor->parent_ = found->parent_;
+// Начальный элемент находится выбором по рангу за O(log n), поэтому выгрузку можно продолжать с любого места
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::toArray(T *buffer, size_t capacity, size_t offset) const {
+    if (offset >= size()) {
+        return 0;
     }
-    if (found->greater_child_ && !found->smaller_child_) {
-        successor = found->greater_child_;
-        found->greater_child_ = nullptr;
-        successor->parent_ = found->parent_;
+    Iterator<T> it(*this);
+    it.shift(offset);
+    size_t count = std::min(capacity, size() - offset);
+    for (size_t i = 0; i < count; i++, it.next()) {
+        buffer[i] = it.value();
     }
+    return count;
+}
 
-    if (!found->isRoot()) {
-        if (found->isSmallerChild()) {
-            found->parent_->smaller_child_ = successor;
-        } else if (found->isGreaterChild()) {
-            found->parent_->greater_child_ = successor;
+template<typename T, typename Compare>
+template<typename OutputIt>
+OutputIt BinarySearchTree<T, Compare>::toArray(OutputIt out) const {
+    for (Iterator<T> it(*this); !it.isEnd(); it.next()) {
+        *out = it.value();
+        ++out;
+    }
+    return out;
+}
+
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::tryAdd(const T &elem) {
+    bool inserted = false;
+    insertNode(elem, inserted);
+    return inserted;
+}
+
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::tryAddMany(const T *arr, size_t size, bool *applied) {
+    size_t added = 0;
+    for (size_t i = 0; i < size; i++) {
+        bool is_added = tryAdd(arr[i]);
+        if (applied) {
+            applied[i] = is_added;
         }
-        delete found;
+        added += is_added;
     }
+    return added;
 }
 
-template<typename T>
-void BinarySearchTree<T>::removeMany(const T *arr, size_t size) {
-    bool nonexistent = false;
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::tryRemove(const T &elem) {
+    Node *found = findNode(elem);
+    if (!found) {
+        return false;
+    }
+    removeNode(found);
+    return true;
+}
+
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::tryRemoveMany(const T *arr, size_t size, bool *applied) {
+    size_t removed = 0;
     for (size_t i = 0; i < size; i++) {
-        try {
-            remove(arr[i]);
-        } catch (BSTNonexistentValueException &err) {
-            nonexistent = true;
+        bool is_removed = tryRemove(arr[i]);
+        if (applied) {
+            applied[i] = is_removed;
         }
+        removed += is_removed;
     }
-    if (nonexistent) {
-        throw BSTNonexistentValueException("nonexistent values to remove");
+    return removed;
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> BinarySearchTree<T, Compare>::unionWith(const BinarySearchTree<T, Compare> &obj) const {
+    return merge(obj, true, true, true);
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> &BinarySearchTree<T, Compare>::operator=(const BinarySearchTree<T, Compare> &obj) {
+    if (this == &obj) {
+        return *this;
     }
+    copy(obj);
+    return *this;
 }
 
-template<typename T>
-void BinarySearchTree<T>::setComparator(std::function<int(T, T)> comparator) {
-    comparator_ = comparator;
-    if (smaller_child_) {
-        smaller_child_->setComparator(comparator);
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> &BinarySearchTree<T, Compare>::operator=(BinarySearchTree<T, Compare> &&obj) noexcept {
+    if (this == &obj) {
+        return *this;
     }
-    if (greater_child_) {
-        greater_child_->setComparator(comparator);
+    clear();
+    root_ = obj.root_;
+    pool_ = std::move(obj.pool_);
+    order_ = obj.order_;
+    balance_ = obj.balance_;
+    comparator_ = obj.comparator_;
+    threads_ = obj.threads_;
+    serial_threshold_ = obj.serial_threshold_;
+    obj.root_ = nullptr;
+    return *this;
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> &BinarySearchTree<T, Compare>::operator+=(const BinarySearchTree<T, Compare> &obj) {
+    extend(obj);
+    return *this;
+}
+
+template<typename _T, typename _Compare>
+BinarySearchTree<_T, _Compare> operator+(const BinarySearchTree<_T, _Compare> &obj1, const BinarySearchTree<_T, _Compare> &obj2) {
+    BinarySearchTree<_T, _Compare> sum(obj1);
+    sum.extend(obj2);
+    return sum;
+}
+
+template<typename _T, typename _Compare>
+std::ostream &operator<<(std::ostream &os, const BinarySearchTree<_T, _Compare> &obj) {
+    os << "{";
+    auto it_begin = obj.begin();
+    for (auto it = it_begin, it_end = obj.end(); it != it_end; ++it) {
+        if (it != it_begin) {
+            os << ", ";
+        }
+        os << *it;
     }
+    os << "}";
+    return os;
 }
 
-template<typename T>
-void BinarySearchTree<T>::setOrder(tree_order order) {
-    order_ = order;
-    if (smaller_child_) {
-        smaller_child_->setOrder(order);
+template<typename _T, typename _Compare>
+bool operator==(const BinarySearchTree<_T, _Compare> &obj1, const BinarySearchTree<_T, _Compare> &obj2) {
+    if (obj1.order_ != obj2.order_) {
+        return false;
+    }
+    if (obj1.size() != obj2.size()) {
+        return false;
     }
-    if (greater_child_) {
-        greater_child_->setOrder(order);
+    for (auto it1 = obj1.begin(), it2 = obj2.begin(), it_end = obj1.end(); it1 != it_end; ++it1, ++it2) {
+        if (*it1 != *it2) {
+            return false;
+        }
     }
+    return true;
 }
 
-template<typename T>
-size_t BinarySearchTree<T>::size() const {
+template<typename _T, typename _Compare>
+bool operator!=(const BinarySearchTree<_T, _Compare> &obj1, const BinarySearchTree<_T, _Compare> &obj2) {
+    return !(obj1 == obj2);
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::addToArray(T *arr) const {
+    if ((order_ == IN_ORDER || order_ == REVERSE_ORDER) && threadsFor(this->size()) > 1) {
+        // Каждый поток записывает свой диапазон позиций, начиная с элемента, найденного выбором по рангу
+        size_t count = this->size();
+        size_t tasks = threads_ * tasks_per_thread_;
+        parallelFor(tasks, threads_, [&](size_t task) {
+            size_t first = count * task / tasks;
+            size_t last = count * (task + 1) / tasks;
+            if (first == last) {
+                return;
+            }
+            Iterator<T> it(&root_, nthElement(root_, first), IN_ORDER);
+            for (size_t i = first; i < last; i++, it.next()) {
+                arr[order_ == IN_ORDER ? i : count - 1 - i] = it.value();
+            }
+        });
+        return;
+    }
     size_t size = 0;
-    if (isEmpty()) {
-        return size;
+    for (Iterator<T> it(*this); !it.isEnd(); it.next()) {
+        arr[size++] = it.value();
     }
-    size++;
+}
 
-    if (smaller_child_) {
-        size += smaller_child_->size();
+template<typename T, typename Compare>
+template<typename Key>
+Iterator<T> BinarySearchTree<T, Compare>::bound(const Key &key, bool upper) const {
+    const Node *node = root_;
+    const Node *found = nullptr;
+    while (node) {
+        if (upper ? !less(key, node->value) : less(node->value, key)) {
+            node = node->greater_child;
+        } else {
+            found = node;
+            node = node->smaller_child;
+        }
     }
-    if (greater_child_) {
-        size += greater_child_->size();
+    return Iterator<T>(&root_, found, IN_ORDER);
+}
+
+template<typename T, typename Compare>
+template<typename Key>
+size_t BinarySearchTree<T, Compare>::countSmaller(const Key &key) const {
+    size_t rank = 0;
+    const Node *node = root_;
+    while (node) {
+        if (less(node->value, key)) {
+            rank += countOf(node->smaller_child) + 1;
+            node = node->greater_child;
+        } else {
+            node = node->smaller_child;
+        }
     }
-    return size;
+    return rank;
 }
 
-template<typename T>
-T *BinarySearchTree<T>::toArray() const {
-    if (isEmpty()) {
-        throw BSTEmptyException("can't convert empty tree");
+template<typename T, typename Compare>
+template<typename RandomIt>
+void BinarySearchTree<T, Compare>::build(RandomIt first, size_t size) {
+    if (!size) {
+        root_ = nullptr;
+        return;
+    }
+    Node *block = pool_.allocate(size);
+    if (threadsFor(size) > 1) {
+        root_ = buildBranchParallel(first, size, block);
+    } else {
+        root_ = buildBranch(first, size, block, nullptr);
     }
-    T *arr = new T[size()];
-    size_t arr_size = 0;
-    addToArray(arr, &arr_size);
-    return arr;
 }
 
-template<typename T>
-BinarySearchTree<T> &BinarySearchTree<T>::operator=(const BinarySearchTree<T> &obj) {
-    if (this == obj) {
-        return *this;
+template<typename T, typename Compare>
+template<typename RandomIt>
+BSTNode<T> *BinarySearchTree<T, Compare>::buildBranch(RandomIt first, size_t size, Node *block, Node *parent) {
+    if (!size) {
+        return nullptr;
     }
-    parent_ = nullptr;
-    smaller_child_ = nullptr;
-    greater_child_ = nullptr;
-    copy(obj);
-    return *this;
+    size_t middle = size / 2;
+    Node *node = new(block + middle) Node{parent, nullptr, nullptr, size, heightOfSize(size),
+                                          static_cast<const T &>(first[middle])};
+    node->smaller_child = buildBranch(first, middle, block, node);
+    node->greater_child = buildBranch(first + middle + 1, size - middle - 1, block + middle + 1, node);
+    return node;
+}
+
+// Верхние уровни строятся последовательно обходом в ширину, пока веток не станет достаточно
+// для всех потоков; высота и размер узла известны заранее, поэтому ветки независимы
+template<typename T, typename Compare>
+template<typename RandomIt>
+BSTNode<T> *BinarySearchTree<T, Compare>::buildBranchParallel(RandomIt first, size_t size, Node *block) {
+    struct Branch {
+        size_t offset;
+        size_t size;
+        Node *parent;
+        Node **link;
+    };
+
+    Node *root = nullptr;
+    std::vector<Branch> branches = {{0, size, nullptr, &root}};
+    size_t built = 0;
+    while (built < branches.size() && branches.size() - built < threads_ * tasks_per_thread_) {
+        Branch branch = branches[built++];
+        size_t middle = branch.size / 2;
+        Node *node = new(block + branch.offset + middle) Node{branch.parent, nullptr, nullptr, branch.size,
+                                                              heightOfSize(branch.size),
+                                                              static_cast<const T &>(first[branch.offset + middle])};
+        *branch.link = node;
+        if (middle) {
+            branches.push_back({branch.offset, middle, node, &node->smaller_child});
+        }
+        if (branch.size - middle - 1) {
+            branches.push_back({branch.offset + middle + 1, branch.size - middle - 1, node, &node->greater_child});
+        }
+    }
+    parallelFor(branches.size() - built, threads_, [&](size_t i) {
+        const Branch &branch = branches[built + i];
+        *branch.link = buildBranch(first + branch.offset, branch.size, block + branch.offset, branch.parent);
+    });
+    return root;
+}
+
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::countOf(const Node *node) {
+    return node ? node->count : 0;
+}
+
+template<typename T, typename Compare>
+template<typename A, typename B>
+int BinarySearchTree<T, Compare>::compare(const A &a, const B &b) const {
+    if constexpr (three_way_) {
+        return comparator_(a, b);
+    } else {
+        if (comparator_(a, b)) {
+            return -1;
+        }
+        return comparator_(b, a) ? 1 : 0;
+    }
+}
+
+template<typename T, typename Compare>
+template<typename A, typename B>
+bool BinarySearchTree<T, Compare>::less(const A &a, const B &b) const {
+    if constexpr (three_way_) {
+        return comparator_(a, b) < 0;
+    } else {
+        return comparator_(a, b);
+    }
+}
+
+// Ветки сравниваются синхронным обходом по ссылкам на родителей, без рекурсии
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::containsBranch(const Node *branch) const {
+    const Node *start = findNode(branch->value);
+    if (!start) {
+        return false;
+    }
+    const Node *node = start;
+    while (true) {
+        if (compare(node->value, branch->value)) {
+            return false;
+        }
+        if (node->smaller_child && branch->smaller_child) {
+            node = node->smaller_child;
+            branch = branch->smaller_child;
+            continue;
+        }
+        if (node->greater_child && branch->greater_child) {
+            node = node->greater_child;
+            branch = branch->greater_child;
+            continue;
+        }
+        while (true) {
+            if (node == start) {
+                return true;
+            }
+            const Node *parent = node->parent;
+            const Node *branch_parent = branch->parent;
+            bool from_smaller = (parent->smaller_child == node);
+            node = parent;
+            branch = branch_parent;
+            if (from_smaller && node->greater_child && branch->greater_child) {
+                node = node->greater_child;
+                branch = branch->greater_child;
+                break;
+            }
+        }
+    }
+}
+
+// Копия строится в прямом порядке: спуск к еще не скопированному потомку,
+// иначе подъем к родителю, поэтому стек не растет с высотой дерева
+template<typename T, typename Compare>
+BSTNode<T> *BinarySearchTree<T, Compare>::copyBranch(const Node *branch, Node *parent) {
+    if (!branch) {
+        return nullptr;
+    }
+    Node *copy = pool_.create(parent, nullptr, nullptr, branch->count, branch->height, branch->value);
+    const Node *source = branch;
+    Node *node = copy;
+    while (true) {
+        if (source->smaller_child && !node->smaller_child) {
+            source = source->smaller_child;
+            node->smaller_child = pool_.create(node, nullptr, nullptr, source->count, source->height,
+                                               source->value);
+            node = node->smaller_child;
+        } else if (source->greater_child && !node->greater_child) {
+            source = source->greater_child;
+            node->greater_child = pool_.create(node, nullptr, nullptr, source->count, source->height,
+                                               source->value);
+            node = node->greater_child;
+        } else if (source != branch) {
+            source = source->parent;
+            node = node->parent;
+        } else {
+            return copy;
+        }
+    }
+}
+
+// Узел с рангом i копируется в i-й слот блока, поэтому слоты родителя и потомков вычисляются
+// по размерам веток, и каждый поток копирует свой диапазон рангов независимо
+template<typename T, typename Compare>
+BSTNode<T> *BinarySearchTree<T, Compare>::copyTreeParallel(const Node *root) {
+    size_t count = countOf(root);
+    Node *block = pool_.allocate(count);
+    size_t tasks = threads_ * tasks_per_thread_;
+    parallelFor(tasks, threads_, [&](size_t task) {
+        size_t first = count * task / tasks;
+        size_t last = count * (task + 1) / tasks;
+        if (first == last) {
+            return;
+        }
+        Iterator<T> it(&root, nthElement(root, first), IN_ORDER);
+        for (size_t i = first; i < last; i++, it.next()) {
+            const Node *source = it.node_;
+            Node *parent = nullptr;
+            if (isSmallerChild(source)) {
+                parent = block + i + countOf(source->greater_child) + 1;
+            } else if (isGreaterChild(source)) {
+                parent = block + i - countOf(source->smaller_child) - 1;
+            }
+            Node *smaller = nullptr;
+            if (source->smaller_child) {
+                smaller = block + i - countOf(source->smaller_child->greater_child) - 1;
+            }
+            Node *greater = nullptr;
+            if (source->greater_child) {
+                greater = block + i + countOf(source->greater_child->smaller_child) + 1;
+            }
+            new(block + i) Node{parent, smaller, greater, source->count, source->height, source->value};
+        }
+    });
+    return block + countOf(root->smaller_child);
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::dealloc(Node *node) {
+    if (!node) {
+        return;
+    }
+    Node *stop = node->parent;
+    while (node != stop) {
+        if (node->smaller_child) {
+            Node *child = node->smaller_child;
+            node->smaller_child = nullptr;
+            node = child;
+        } else if (node->greater_child) {
+            Node *child = node->greater_child;
+            node->greater_child = nullptr;
+            node = child;
+        } else {
+            Node *parent = node->parent;
+            pool_.destroy(node);
+            node = parent;
+        }
+    }
+}
+
+// Трехстороннее сравнение позволяет остановиться на равном узле. Для предиката "меньше"
+// на каждом уровне делается один вызов: спуск идет до листа с запоминанием последнего узла,
+// не большего key, и равенство проверяется одним дополнительным вызовом в конце
+template<typename T, typename Compare>
+template<typename Key>
+BSTNode<T> *BinarySearchTree<T, Compare>::descend(const Key &key, Node *&parent, bool &smaller) const {
+    parent = nullptr;
+    smaller = false;
+    Node *node = root_;
+    if constexpr (three_way_) {
+        while (node) {
+            int comparison = comparator_(key, node->value);
+            if (!comparison) {
+                return node;
+            }
+            parent = node;
+            smaller = comparison < 0;
+            node = smaller ? node->smaller_child : node->greater_child;
+        }
+        return nullptr;
+    } else {
+        Node *candidate = nullptr;
+        while (node) {
+            parent = node;
+            smaller = comparator_(key, node->value);
+            if (smaller) {
+                node = node->smaller_child;
+            } else {
+                candidate = node;
+                node = node->greater_child;
+            }
+        }
+        if (candidate && !comparator_(candidate->value, key)) {
+            return candidate;
+        }
+        return nullptr;
+    }
+}
+
+template<typename T, typename Compare>
+template<typename Key>
+BSTNode<T> *BinarySearchTree<T, Compare>::findNode(const Key &key) const {
+    Node *parent = nullptr;
+    bool smaller = false;
+    return descend(key, parent, smaller);
+}
+
+template<typename T, typename Compare>
+template<typename Value>
+BSTNode<T> *BinarySearchTree<T, Compare>::attachNode(Node *parent, bool smaller, Value &&elem) {
+    Node *node = pool_.create(parent, nullptr, nullptr, (size_t) 1, 1, std::forward<Value>(elem));
+    if (!parent) {
+        root_ = node;
+        return node;
+    }
+    if (smaller) {
+        parent->smaller_child = node;
+    } else {
+        parent->greater_child = node;
+    }
+    for (Node *branch = parent; branch; branch = rebalance(branch)->parent) {}
+    return node;
+}
+
+template<typename T, typename Compare>
+template<typename Value>
+BSTNode<T> *BinarySearchTree<T, Compare>::insertNode(Value &&elem, bool &inserted) {
+    Node *parent = nullptr;
+    bool smaller = false;
+    Node *found = descend(elem, parent, smaller);
+    inserted = !found;
+    if (found) {
+        return found;
+    }
+    return attachNode(parent, smaller, std::forward<Value>(elem));
+}
+
+// Если элемент попадает между соседними по значению узлами, то у одного из них свободна нужная
+// ветка: у большего - меньшая, иначе у меньшего - большая. Поэтому при подходящей подсказке
+// достаточно двух сравнений, а спуск от корня выполняется, только если элемент не попал рядом с ней
+template<typename T, typename Compare>
+template<typename Value>
+BSTNode<T> *BinarySearchTree<T, Compare>::insertNodeNear(const Node *hint, Value &&elem, bool &inserted) {
+    Node *greater = const_cast<Node *>(hint);
+    Node *smaller = nullptr;
+    if (greater) {
+        smaller = const_cast<Node *>(Iterator<T>::inOrderPrevious(greater));
+    } else if (root_) {
+        smaller = maxElement(root_);
+    }
+    if (greater && !less(elem, greater->value)) {
+        // элемент не меньше подсказки: проверяется место сразу после нее
+        smaller = greater;
+        greater = const_cast<Node *>(Iterator<T>::inOrderNext(smaller));
+        if (!less(smaller->value, elem) || (greater && !less(elem, greater->value))) {
+            return insertNode(std::forward<Value>(elem), inserted);
+        }
+    } else if (smaller && !less(smaller->value, elem)) {
+        return insertNode(std::forward<Value>(elem), inserted);
+    }
+
+    inserted = true;
+    if (greater && !greater->smaller_child) {
+        return attachNode(greater, true, std::forward<Value>(elem));
+    }
+    return attachNode(smaller, false, std::forward<Value>(elem));
+}
+
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::isGreaterChild(const Node *node) {
+    if (isRoot(node)) {
+        return false;
+    }
+    return node->parent->greater_child == node;
+}
+
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::isSmallerChild(const Node *node) {
+    if (isRoot(node)) {
+        return false;
+    }
+    return node->parent->smaller_child == node;
 }
 
-template<typename T>
-BinarySearchTree<T> &BinarySearchTree<T>::operator+=(const BinarySearchTree<T> &obj) {
-    extend(obj);
-    return *this;
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::isRoot(const Node *node) {
+    return !((bool) node->parent);
 }
 
-template<typename _T>
-BinarySearchTree<_T> operator+(const BinarySearchTree<_T> &obj1, const BinarySearchTree<_T> &obj2) {
-    BinarySearchTree<_T> sum(obj1);
-    sum.extend(obj2);
-    return sum;
+template<typename T, typename Compare>
+int BinarySearchTree<T, Compare>::heightOfSize(size_t size) {
+    int height = 0;
+    for (; size; size /= 2) {
+        height++;
+    }
+    return height;
 }
 
-template<typename _T>
-std::ostream &operator<<(std::ostream &os, const BinarySearchTree<_T> &obj) {
-    os << "{";
-    if (!obj.isEmpty()) {
-        auto it_begin = *obj.iteratorBegin();
-        auto it_end = --(*obj.iteratorEnd());
-        for (auto it = it_begin; it < it_end; it++) {
-            os << *it << ", ";
-        }
-        os << *it_end;
+template<typename T, typename Compare>
+BSTNode<T> *BinarySearchTree<T, Compare>::maxElement(Node *node) {
+    while (node->greater_child) {
+        node = node->greater_child;
     }
-    os << "}";
-    return os;
+    return node;
 }
 
-template<typename _T>
-bool operator==(const BinarySearchTree<_T> &obj1, const BinarySearchTree<_T> &obj2) {
-    if (obj1.order_ != obj2.order_) {
-        return false;
+template<typename T, typename Compare>
+BSTNode<T> *BinarySearchTree<T, Compare>::minElement(Node *node) {
+    while (node->smaller_child) {
+        node = node->smaller_child;
     }
-    if (obj1.size() != obj2.size()) {
-        return false;
-    }
-    if (!obj1.isEmpty()) {
-        for (auto it1 = *obj1.iteratorBegin(), it2 = *obj2.iteratorBegin(); it1 < *obj1.iteratorEnd();
-             it1++, it2++) {
-            if (*it1 != *it2) {
-                return false;
+    return node;
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> BinarySearchTree<T, Compare>::merge(const BinarySearchTree<T, Compare> &obj,
+                                                                 bool take_this_only, bool take_both,
+                                                                 bool take_obj_only) const {
+    std::vector<std::reference_wrapper<const T>> merged;
+    merged.reserve(size() + obj.size());
+    Iterator<T> it1(*this, IN_ORDER);
+    Iterator<T> it2(obj, IN_ORDER);
+    while (!it1.isEnd() && !it2.isEnd()) {
+        int comparison = compare(it1.value(), it2.value());
+        if (comparison < 0) {
+            if (take_this_only) {
+                merged.push_back(it1.value());
+            }
+            it1.next();
+        } else if (comparison > 0) {
+            if (take_obj_only) {
+                merged.push_back(it2.value());
             }
+            it2.next();
+        } else {
+            if (take_both) {
+                merged.push_back(it1.value());
+            }
+            it1.next();
+            it2.next();
         }
     }
-    return true;
-}
+    for (; take_this_only && !it1.isEnd(); it1.next()) {
+        merged.push_back(it1.value());
+    }
+    for (; take_obj_only && !it2.isEnd(); it2.next()) {
+        merged.push_back(it2.value());
+    }
 
-template<typename _T>
-bool operator!=(const BinarySearchTree<_T> &obj1, const BinarySearchTree <_T> &obj2) {
-    return !(obj1 == obj2);
+    BinarySearchTree<T, Compare> result(order_, comparator_, balance_);
+    result.setParallelism(threads_, serial_threshold_);
+    result.build(merged.begin(), merged.size());
+    return result;
 }
 
-template<typename T>
-void BinarySearchTree<T>::addToArray(T *arr, size_t *current_size) const {
-    size_t *size = current_size;
-    if (order_ == IN_ORDER) {
-        if (smaller_child_) {
-            smaller_child_->addToArray(arr, size);
-        }
-        arr[(*size)++] = value_;
-        if (greater_child_) {
-            greater_child_->addToArray(arr, size);
-        }
-    } else if (order_ == REVERSE_ORDER) {
-        if (greater_child_) {
-            greater_child_->addToArray(arr, size);
-        }
-        arr[(*size)++] = value_;
-        if (smaller_child_) {
-            smaller_child_->addToArray(arr, size);
+template<typename T, typename Compare>
+const BSTNode<T> *BinarySearchTree<T, Compare>::nthElement(const Node *node, size_t k) {
+    while (k != countOf(node->smaller_child)) {
+        if (k < countOf(node->smaller_child)) {
+            node = node->smaller_child;
+        } else {
+            k -= countOf(node->smaller_child) + 1;
+            node = node->greater_child;
         }
-    } else if (order_ == PRE_ORDER) {
-        arr[(*size)++] = value_;
-        if (smaller_child_) {
-            smaller_child_->addToArray(arr, size);
+    }
+    return node;
+}
+
+template<typename T, typename Compare>
+int BinarySearchTree<T, Compare>::balanceFactor(const Node *node) {
+    return heightOf(node->smaller_child) - heightOf(node->greater_child);
+}
+
+// Форма AVL-дерева не зависит от порядка добавления, поэтому, если вставка
+// по одному элементу дороже слияния, дерево перестраивается слиянием
+template<typename T, typename Compare>
+bool BinarySearchTree<T, Compare>::preferRebuild(size_t count) const {
+    return balance_ == AVL && size() + count < count * std::max(heightOf(root_), 2);
+}
+
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::rebuild(const T *arr, size_t size, bool remove) {
+    std::vector<T> values(arr, arr + size);
+    parallelSort(values.begin(), values.end(), [this](const T &a, const T &b) {
+        return less(a, b);
+    }, threadsFor(size));
+
+    std::vector<std::reference_wrapper<const T>> merged;
+    merged.reserve(remove ? this->size() : this->size() + size);
+    size_t applied = 0;
+    auto value = values.begin();
+    for (Iterator<T> it(*this, IN_ORDER); !it.isEnd(); it.next()) {
+        for (; value != values.end() && less(*value, it.value()); ++value) {
+            if (!remove && (merged.empty() || less(merged.back().get(), *value))) {
+                merged.push_back(*value);
+                applied++;
+            }
         }
-        if (greater_child_) {
-            greater_child_->addToArray(arr, size);
+        bool matched = false;
+        for (; value != values.end() && !less(it.value(), *value); ++value) {
+            matched = true;
         }
-    } else if (order_ == POST_ORDER) {
-        if (smaller_child_) {
-            smaller_child_->addToArray(arr, size);
+        if (remove && matched) {
+            applied++;
+        } else {
+            merged.push_back(it.value());
         }
-        if (greater_child_) {
-            greater_child_->addToArray(arr, size);
+    }
+    for (; !remove && value != values.end(); ++value) {
+        if (merged.empty() || less(merged.back().get(), *value)) {
+            merged.push_back(*value);
+            applied++;
         }
-        arr[(*size)++] = value_;
     }
+
+    BinarySearchTree<T, Compare> result(order_, comparator_, balance_);
+    result.setParallelism(threads_, serial_threshold_);
+    result.build(merged.begin(), merged.size());
+    *this = std::move(result);
+    return applied;
 }
 
-template<typename T>
-void BinarySearchTree<T>::dealloc() {
-    if (smaller_child_) {
-        smaller_child_->dealloc();
-        delete smaller_child_;
-        smaller_child_ = nullptr;
+template<typename T, typename Compare>
+BSTNode<T> *BinarySearchTree<T, Compare>::rebalance(Node *node) {
+    updateNode(node);
+    if (balance_ != AVL) {
+        return node;
+    }
+    int factor = balanceFactor(node);
+    if (factor > 1) {
+        if (balanceFactor(node->smaller_child) < 0) {
+            rotateSmaller(node->smaller_child);
+        }
+        return rotateGreater(node);
     }
-    if (greater_child_) {
-        greater_child_->dealloc();
-        delete greater_child_;
-        greater_child_ = nullptr;
+    if (factor < -1) {
+        if (balanceFactor(node->greater_child) > 0) {
+            rotateGreater(node->greater_child);
+        }
+        return rotateSmaller(node);
     }
+    return node;
 }
 
-template<typename T>
-int BinarySearchTree<T>::defaultCompare(T a, T b) {
-    if (a > b) {
-        return 1;
-    } else if (a < b) {
-        return -1;
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::replaceChild(Node *parent, Node *old_child, Node *new_child) {
+    if (!parent) {
+        root_ = new_child;
+    } else if (parent->smaller_child == old_child) {
+        parent->smaller_child = new_child;
     } else {
-        return 0;
+        parent->greater_child = new_child;
     }
 }
 
-template<typename T>
-BinarySearchTree<T> *BinarySearchTree<T>::find(const T &elem) {
-    if (empty_) {
-        return nullptr;
+template<typename T, typename Compare>
+BSTNode<T> *BinarySearchTree<T, Compare>::rotateSmaller(Node *node) {
+    Node *pivot = node->greater_child;
+    node->greater_child = pivot->smaller_child;
+    if (node->greater_child) {
+        node->greater_child->parent = node;
     }
-    if (elem < value_ && smaller_child_) {
-        return smaller_child_->find(elem);
+    pivot->parent = node->parent;
+    replaceChild(node->parent, node, pivot);
+    pivot->smaller_child = node;
+    node->parent = pivot;
+
+    updateNode(node);
+    updateNode(pivot);
+    return pivot;
+}
+
+template<typename T, typename Compare>
+BSTNode<T> *BinarySearchTree<T, Compare>::rotateGreater(Node *node) {
+    Node *pivot = node->smaller_child;
+    node->smaller_child = pivot->greater_child;
+    if (node->smaller_child) {
+        node->smaller_child->parent = node;
     }
-    if (elem > value_ && greater_child_) {
-        return greater_child_->find(elem);
+    pivot->parent = node->parent;
+    replaceChild(node->parent, node, pivot);
+    pivot->greater_child = node;
+    node->parent = pivot;
+
+    updateNode(node);
+    updateNode(pivot);
+    return pivot;
+}
+
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::removeNode(Node *node) {
+    if (node->smaller_child && node->greater_child) {
+        Node *successor = nullptr;
+        if (countOf(node->smaller_child) > countOf(node->greater_child)) {
+            successor = maxElement(node->smaller_child);
+        } else {
+            successor = minElement(node->greater_child);
+        }
+        swapPositions(node, successor);
     }
-    if (elem == value_) {
-        return this;
+    unlink(node);
+}
+
+// Порядок элементов нарушается только до удаления node, которое выполняется сразу после обмена
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::swapPositions(Node *node, Node *descendant) {
+    Node *parent = node->parent;
+    Node *smaller = node->smaller_child;
+    Node *greater = node->greater_child;
+    Node *descendant_parent = descendant->parent;
+
+    replaceChild(parent, node, descendant);
+    descendant->parent = parent;
+    node->smaller_child = descendant->smaller_child;
+    node->greater_child = descendant->greater_child;
+    if (descendant_parent == node) {
+        descendant->smaller_child = smaller == descendant ? node : smaller;
+        descendant->greater_child = greater == descendant ? node : greater;
+        node->parent = descendant;
+    } else {
+        replaceChild(descendant_parent, descendant, node);
+        descendant->smaller_child = smaller;
+        descendant->greater_child = greater;
+        node->parent = descendant_parent;
     }
-    return nullptr;
-}
+    std::swap(node->count, descendant->count);
+    std::swap(node->height, descendant->height);
 
-template<typename T>
-bool BinarySearchTree<T>::isGreaterChild() const {
-    if (isRoot()) {
-        return false;
+    for (Node *branch : {node, descendant}) {
+        if (branch->smaller_child) {
+            branch->smaller_child->parent = branch;
+        }
+        if (branch->greater_child) {
+            branch->greater_child->parent = branch;
+        }
     }
-    return (value_ == parent_->greater_child_->value_);
 }
 
-template<typename T>
-bool BinarySearchTree<T>::isSmallerChild() const {
-    if (isRoot()) {
-        return false;
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::unlink(Node *node) {
+    Node *child = node->smaller_child ? node->smaller_child : node->greater_child;
+    Node *parent = node->parent;
+    replaceChild(parent, node, child);
+    if (child) {
+        child->parent = parent;
     }
-    return (value_ == parent_->smaller_child_->value_);
-}
+    pool_.destroy(node);
 
-template<typename T>
-bool BinarySearchTree<T>::isRoot() const {
-    return !((bool) parent_);
+    for (Node *branch = parent; branch; branch = rebalance(branch)->parent) {}
 }
 
-template<typename T>
-BinarySearchTree<T> *BinarySearchTree<T>::maxElement() {
-    BinarySearchTree<T> *maximum = this;
-    if (greater_child_) {
-        maximum = greater_child_->maxElement();
-    }
-    return maximum;
+template<typename T, typename Compare>
+void BinarySearchTree<T, Compare>::updateNode(Node *node) {
+    node->count = 1 + countOf(node->smaller_child) + countOf(node->greater_child);
+    node->height = 1 + std::max(heightOf(node->smaller_child), heightOf(node->greater_child));
 }
 
-template<typename T>
-BinarySearchTree<T> *BinarySearchTree<T>::minElement() {
-    BinarySearchTree<T> *minimum = this;
-    if (smaller_child_) {
-        minimum = smaller_child_->minElement();
-    }
-    return minimum;
+template<typename T, typename Compare>
+int BinarySearchTree<T, Compare>::heightOf(const Node *node) {
+    return node ? node->height : 0;
 }
 
+template<typename T, typename Compare>
+size_t BinarySearchTree<T, Compare>::threadsFor(size_t count) const {
+    return count > 1 && count >= serial_threshold_ ? threads_ : 1;
+}
 
-
+// Итератор - значение из указателя на узел и указателя на корень дерева: копирование и сравнение на равенство
+// за O(1), добавление и удаление других элементов не делают итератор недействительным.
+// Позиция вычисляется по размерам веток, а смещение на произвольное число позиций выполняется выбором
+// по рангу за O(высоты) - O(n) для несбалансированного дерева, поэтому для алгоритмов итератор объявлен двунаправленным
 template<typename T>
 class Iterator {
 public:
-    Iterator() = delete;
-//    Конструктор по умолчанию (удален)
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
 
-    explicit Iterator(const BinarySearchTree<T> &tree);
+    Iterator();
+//    Конструктор по умолчанию (итератор не связан с деревом и равен концу пустого дерева)
+
+    template<typename Compare>
+    explicit Iterator(const BinarySearchTree<T, Compare> &tree);
 //    Перегрузка конструктора
 
-    Iterator(const Iterator<T> &obj);
+    template<typename Compare>
+    Iterator(const BinarySearchTree<T, Compare> &tree, tree_order order);
+//    Перегрузка конструктора (проход в указанном порядке вместо порядка дерева)
+
+    Iterator(const Iterator<T> &obj) = default;
 //    Конструктор копирования
 
-    ~Iterator();
+    ~Iterator() = default;
 //    Деструктор
 
     Iterator<T> &begin();
@@ -651,14 +2086,14 @@ public:
     Iterator<T> &end();
 //    Получить итератор на фиктивный элемент, следующий за последним
 
-    bool hasNext();
+    bool hasNext() const;
 //    Имеет ли итератор следующий элемент (в т. ч. фиктивный)
 
-    bool hasPrevious();
+    bool hasPrevious() const;
 //    Имеет ли итератор предыдущий элемент
 
-    bool isEnd();
-//    Находится ли итератор наа фиктивном элементе, следующем за последним
+    bool isEnd() const;
+//    Находится ли итератор на фиктивном элементе, следующем за последним
 
     void next();
 //    Сместиться на следующий элемент
@@ -666,13 +2101,16 @@ public:
     void previous();
 //    Сместиться на предыдущий элемент
 
-    T &value();
+    const T &value() const;
 //    Получить значение текущего элемента
 
-    Iterator<T> &operator+=(int offset);
+    Iterator<T> &operator=(const Iterator<T> &obj) = default;
+//    Перегрузка оператора присваивания
+
+    Iterator<T> &operator+=(difference_type offset);
 //    Сместить текущий итератор на offset позиций вперед
 
-    Iterator<T> &operator-=(int offset);
+    Iterator<T> &operator-=(difference_type offset);
 //    Сместить текущий итератор на offset позиций назад
 
     Iterator<T> &operator++();
@@ -687,101 +2125,156 @@ public:
     Iterator<T> operator--(int);
 //    Сместить итератор на одну позицию назад и вернуть прежнее значение
 
-    T &operator*();
+    const T &operator*() const;
 //    Получить значение текущего элемента
 
-    bool operator==(Iterator<T> &it);
-//    Перегрузка оператора равенства
+    const T *operator->() const;
+//    Получить указатель на значение текущего элемента
+
+    const T &operator[](difference_type offset) const;
+//    Получить значение элемента, смещенного на offset позиций
 
-    bool operator!=(Iterator<T> &it);
+    bool operator!=(const Iterator<T> &it) const;
 //    Перегрузка оператора неравенства
 
-    bool operator<(Iterator<T> &it);
+    bool operator==(const Iterator<T> &it) const;
+//    Перегрузка оператора равенства (итераторы на один элемент; все итераторы на фиктивный элемент равны)
+
+    bool operator<(const Iterator<T> &it) const;
 //    Перегрузка оператора "меньше" (сравниваются позиции итераторов)
 
-    bool operator>(Iterator<T> &it);
+    bool operator>(const Iterator<T> &it) const;
 //    Перегрузка оператора "больше" (сравниваются позиции итераторов)
 
-    bool operator<=(Iterator<T> &it);
+    bool operator<=(const Iterator<T> &it) const;
 //    Перегрузка оператора "меньше или равно" (сравниваются позиции итераторов)
 
-    bool operator>=(Iterator<T> &it);
+    bool operator>=(const Iterator<T> &it) const;
 //    Перегрузка оператора "больше или равно" (сравниваются позиции итераторов)
 
     template<typename _T>
-    friend Iterator<_T> operator+(const Iterator<_T> &obj, int offset);
+    friend Iterator<_T> operator+(const Iterator<_T> &obj, typename Iterator<_T>::difference_type offset);
+//    Вернуть итератор, смещенный на offset позиций вперед
+
+    template<typename _T>
+    friend Iterator<_T> operator+(typename Iterator<_T>::difference_type offset, const Iterator<_T> &obj);
 //    Вернуть итератор, смещенный на offset позиций вперед
 
     template<typename _T>
-    friend Iterator<_T> operator-(const Iterator<_T> &obj, int offset);
+    friend Iterator<_T> operator-(const Iterator<_T> &obj, typename Iterator<_T>::difference_type offset);
 //    Вернуть итератор, смещенный на offset позиций назад
 
+    template<typename _T>
+    friend typename Iterator<_T>::difference_type operator-(const Iterator<_T> &obj1, const Iterator<_T> &obj2);
+//    Расстояние между позициями итераторов
+
 private:
-    T *flattened_tree_;
-    size_t size_;
-    size_t pos_;
+    template<typename, typename>
+    friend class BinarySearchTree;
+
+    using Node = BSTNode<T>;
+
+    Iterator(const Node *const *root, const Node *node, tree_order order);
+//    Конструктор итератора на указанный элемент (root - указатель на корень дерева)
+
+    void shift(long long offset);
+//    Сместить итератор на offset позиций (с проверкой выхода за фиктивный элемент)
+
+    const Node *rootNode() const;
+//    Текущий корень дерева (nullptr для пустого дерева): для элемента - подъемом по ссылкам на родителей,
+//    для фиктивного элемента - по указателю на корень дерева
+
+    size_t size() const;
+//    Текущее количество элементов дерева
+
+    size_t position() const;
+//    Позиция итератора в порядке прохода (вычисляется по размерам веток при подъеме к корню)
+
+    const Node *nodeAt(size_t pos) const;
+//    Элемент с указанной позицией в порядке прохода (nullptr для фиктивного элемента)
+
+    const Node *firstNode() const;
+//    Первый элемент в порядке прохода (nullptr для пустого дерева)
+
+    const Node *lastNode() const;
+//    Последний элемент в порядке прохода (nullptr для пустого дерева)
+
+    const Node *nextNode(const Node *node) const;
+//    Элемент, следующий за данным в порядке прохода (nullptr после последнего)
+
+    const Node *previousNode(const Node *node) const;
+//    Элемент, предшествующий данному в порядке прохода (nullptr перед первым)
+
+    static const Node *inOrderNext(const Node *node);
+//    Следующий элемент в порядке возрастания
+
+    static const Node *inOrderPrevious(const Node *node);
+//    Предыдущий элемент в порядке возрастания
+
+    static const Node *preOrderLast(const Node *node);
+//    Последний элемент ветки в прямом порядке
+
+    static const Node *postOrderFirst(const Node *node);
+//    Первый элемент ветки в обратном порядке
+
+    const Node *const *root_; // нужен только фиктивному элементу, поэтому перенос дерева делает недействительным лишь его
+    const Node *node_; // nullptr - фиктивный элемент, следующий за последним
+    tree_order order_;
 };
 
 template<typename T>
-Iterator<T>::Iterator(const BinarySearchTree<T> &tree) {
-    try {
-        flattened_tree_ = tree.toArray();
-    } catch (BSTEmptyException &err) {
-        flattened_tree_ = nullptr;
-    }
-    size_ = tree.size();
-    pos_ = 0;
+template<typename Compare>
+Iterator<T>::Iterator(const BinarySearchTree<T, Compare> &tree)
+        : Iterator(tree, tree.order_) {}
+
+template<typename T>
+template<typename Compare>
+Iterator<T>::Iterator(const BinarySearchTree<T, Compare> &tree, tree_order order) {
+    root_ = &tree.root_;
+    node_ = nullptr;
+    order_ = order;
+    begin();
 }
 
 template<typename T>
-Iterator<T>::Iterator(const Iterator<T> &obj) {
-    size_ = obj.size_;
-    pos_ = obj.pos_;
-    if (!obj.size_) {
-        flattened_tree_ = nullptr;
-    } else {
-        flattened_tree_ = new T[obj.size_];
-        for (size_t i = 0; i < size_; i++) {
-            flattened_tree_[i] = obj.flattened_tree_[i];
-        }
-    }
+Iterator<T>::Iterator() {
+    root_ = nullptr;
+    node_ = nullptr;
+    order_ = IN_ORDER;
 }
 
 template<typename T>
-Iterator<T>::~Iterator() {
-    if (flattened_tree_) {
-        delete [] flattened_tree_;
-    }
+Iterator<T>::Iterator(const Node *const *root, const Node *node, tree_order order) {
+    root_ = root;
+    node_ = node;
+    order_ = order;
 }
 
 template<typename T>
 Iterator<T> &Iterator<T>::begin() {
-    pos_ = 0;
+    node_ = firstNode();
     return *this;
 }
 
 template<typename T>
 Iterator<T> &Iterator<T>::end() {
-    pos_ = size_;
+    node_ = nullptr;
     return *this;
 }
 
 template<typename T>
-bool Iterator<T>::hasNext() {
-    if (!size_) {
-        return false;
-    }
-    return pos_ <= size_ - 1;
+bool Iterator<T>::hasNext() const {
+    return node_ != nullptr;
 }
 
 template<typename T>
-bool Iterator<T>::hasPrevious() {
-    return pos_ > 0;
+bool Iterator<T>::hasPrevious() const {
+    return (node_ ? previousNode(node_) : rootNode()) != nullptr;
 }
 
 template<typename T>
-bool Iterator<T>::isEnd() {
-    return pos_ == size_;
+bool Iterator<T>::isEnd() const {
+    return !node_;
 }
 
 template<typename T>
@@ -789,40 +2282,35 @@ void Iterator<T>::next() {
     if (!hasNext()) {
         throw BSTIteratorOutOfRangeException("iterator out of range");
     }
-    pos_++;
+    node_ = nextNode(node_);
 }
 
 template<typename T>
 void Iterator<T>::previous() {
-    if (!hasPrevious()) {
+    const Node *previous = node_ ? previousNode(node_) : lastNode();
+    if (!previous) {
         throw BSTIteratorOutOfRangeException("iterator out of range");
     }
-    pos_--;
+    node_ = previous;
 }
 
 template<typename T>
-T &Iterator<T>::value() {
+const T &Iterator<T>::value() const {
     if (isEnd()) {
         throw BSTIteratorAccessingEndValueException("end value to access");
     }
-    return flattened_tree_[pos_];
+    return node_->value;
 }
 
 template<typename T>
-Iterator<T> &Iterator<T>::operator+=(int offset) {
-    if (pos_ + offset > size_ || pos_ + offset < 0) {
-        throw BSTIteratorOutOfRangeException("iterator out of range");
-    }
-    pos_ += offset;
+Iterator<T> &Iterator<T>::operator+=(difference_type offset) {
+    shift(offset);
     return *this;
 }
 
 template<typename T>
-Iterator<T> &Iterator<T>::operator-=(int offset) {
-    if (pos_ - offset > size_ || pos_ - offset < 0) {
-        throw BSTIteratorOutOfRangeException("iterator out of range");
-    }
-    pos_ -= offset;
+Iterator<T> &Iterator<T>::operator-=(difference_type offset) {
+    shift(-offset);
     return *this;
 }
 
@@ -853,69 +2341,337 @@ Iterator<T> Iterator<T>::operator--(int) {
 }
 
 template<typename T>
-T &Iterator<T>::operator*() {
+const T &Iterator<T>::operator*() const {
     return value();
 }
 
 template<typename T>
-bool Iterator<T>::operator==(Iterator<T> &it) {
-    if (size_ != it.size_) {
-        return false;
-    }
-    if (pos_ != it.pos_) {
-        return false;
-    }
-    for (size_t i = 0; i < size_; i++) {
-        if (flattened_tree_[i] != it.flattened_tree_[i]) {
-            return false;
-        }
-    }
-    return true;
+const T *Iterator<T>::operator->() const {
+    return &value();
+}
+
+template<typename T>
+const T &Iterator<T>::operator[](difference_type offset) const {
+    return (*this + offset).value();
 }
 
 template<typename T>
-bool Iterator<T>::operator!=(Iterator<T> &it) {
+bool Iterator<T>::operator==(const Iterator<T> &it) const {
+    return node_ == it.node_;
+}
+
+template<typename T>
+bool Iterator<T>::operator!=(const Iterator<T> &it) const {
     return !(*this == it);
 }
 
 template<typename T>
-bool Iterator<T>::operator<(Iterator<T> &it) {
-    return pos_ < it.pos_;
+bool Iterator<T>::operator<(const Iterator<T> &it) const {
+    return position() < it.position();
 }
 
 template<typename T>
-bool Iterator<T>::operator>(Iterator<T> &it) {
-    return pos_ > it.pos_;
+bool Iterator<T>::operator>(const Iterator<T> &it) const {
+    return position() > it.position();
 }
 
 template<typename T>
-bool Iterator<T>::operator<=(Iterator<T> &it) {
+bool Iterator<T>::operator<=(const Iterator<T> &it) const {
     return *this < it or *this == it;
 }
 
 template<typename T>
-bool Iterator<T>::operator>=(Iterator<T> &it) {
+bool Iterator<T>::operator>=(const Iterator<T> &it) const {
     return *this > it or *this == it;
 }
 
 template<typename _T>
-Iterator<_T> operator+(const Iterator<_T> &obj, int offset) {
+Iterator<_T> operator+(const Iterator<_T> &obj, typename Iterator<_T>::difference_type offset) {
     Iterator<_T> sum(obj);
-    if (obj.pos_ + offset >= obj.size_ || obj.pos_ + offset < 0) {
-        throw BSTIteratorOutOfRangeException("iterator out of range");
-    }
-    sum.pos_ += offset;
+    sum.shift(offset);
     return sum;
 }
 
 template<typename _T>
-Iterator<_T> operator-(const Iterator<_T> &obj, int offset) {
+Iterator<_T> operator+(typename Iterator<_T>::difference_type offset, const Iterator<_T> &obj) {
+    return obj + offset;
+}
+
+template<typename _T>
+Iterator<_T> operator-(const Iterator<_T> &obj, typename Iterator<_T>::difference_type offset) {
     Iterator<_T> diff(obj);
-    if (obj.pos_ - offset >= obj.size_ || obj.pos_ - offset < 0) {
+    diff.shift(-offset);
+    return diff;
+}
+
+template<typename _T>
+typename Iterator<_T>::difference_type operator-(const Iterator<_T> &obj1, const Iterator<_T> &obj2) {
+    return (typename Iterator<_T>::difference_type) obj1.position() -
+           (typename Iterator<_T>::difference_type) obj2.position();
+}
+
+template<typename T>
+void Iterator<T>::shift(long long offset) {
+    // соседние позиции (std::next, std::prev) достигаются по ссылкам за амортизированное O(1)
+    if (offset == 1) {
+        next();
+        return;
+    }
+    if (offset == -1) {
+        previous();
+        return;
+    }
+    if (!offset) {
+        return;
+    }
+    long long target = (long long) position() + offset;
+    if (target < 0 || target > (long long) size()) {
         throw BSTIteratorOutOfRangeException("iterator out of range");
     }
-    diff.pos_ -= offset;
-    return diff;
+    node_ = nodeAt(target);
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::rootNode() const {
+    if (node_) {
+        const Node *node = node_;
+        while (node->parent) {
+            node = node->parent;
+        }
+        return node;
+    }
+    return root_ ? *root_ : nullptr;
+}
+
+template<typename T>
+size_t Iterator<T>::size() const {
+    const Node *root = rootNode();
+    return root ? root->count : 0;
+}
+
+// Позиция складывается из размеров веток, которые обход проходит раньше узла:
+// при подъеме из большей ветки к позиции добавляется меньшая ветка родителя
+template<typename T>
+size_t Iterator<T>::position() const {
+    if (!node_) {
+        return size();
+    }
+    size_t pos = 0;
+    switch (order_) {
+        case IN_ORDER:
+        case REVERSE_ORDER:
+            pos = node_->smaller_child ? node_->smaller_child->count : 0;
+            for (const Node *branch = node_; branch->parent; branch = branch->parent) {
+                if (branch->parent->greater_child == branch) {
+                    const Node *smaller = branch->parent->smaller_child;
+                    pos += (smaller ? smaller->count : 0) + 1;
+                }
+            }
+            if (order_ == REVERSE_ORDER) {
+                pos = size() - 1 - pos;
+            }
+            break;
+        case PRE_ORDER:
+            for (const Node *branch = node_; branch->parent; branch = branch->parent) {
+                pos++;
+                if (branch->parent->greater_child == branch) {
+                    const Node *smaller = branch->parent->smaller_child;
+                    pos += smaller ? smaller->count : 0;
+                }
+            }
+            break;
+        case POST_ORDER:
+            pos = node_->count - 1;
+            for (const Node *branch = node_; branch->parent; branch = branch->parent) {
+                if (branch->parent->greater_child == branch) {
+                    const Node *smaller = branch->parent->smaller_child;
+                    pos += smaller ? smaller->count : 0;
+                }
+            }
+            break;
+    }
+    return pos;
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::nodeAt(size_t pos) const {
+    size_t size = this->size();
+    if (pos >= size) {
+        return nullptr;
+    }
+    if (order_ == REVERSE_ORDER) {
+        pos = size - 1 - pos;
+    }
+    const Node *node = rootNode();
+    while (true) {
+        size_t smaller = node->smaller_child ? node->smaller_child->count : 0;
+        size_t greater = node->greater_child ? node->greater_child->count : 0;
+        size_t own = smaller;
+        if (order_ == PRE_ORDER) {
+            own = 0;
+        } else if (order_ == POST_ORDER) {
+            own = smaller + greater;
+        }
+        if (pos == own) {
+            return node;
+        }
+        if (order_ == PRE_ORDER) {
+            pos--;
+        }
+        if (pos < smaller) {
+            node = node->smaller_child;
+        } else {
+            pos -= smaller;
+            if (order_ == IN_ORDER || order_ == REVERSE_ORDER) {
+                pos--;
+            }
+            node = node->greater_child;
+        }
+    }
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::firstNode() const {
+    const Node *node = rootNode();
+    if (!node) {
+        return nullptr;
+    }
+    if (order_ == IN_ORDER) {
+        while (node->smaller_child) {
+            node = node->smaller_child;
+        }
+    } else if (order_ == REVERSE_ORDER) {
+        while (node->greater_child) {
+            node = node->greater_child;
+        }
+    } else if (order_ == POST_ORDER) {
+        node = postOrderFirst(node);
+    }
+    return node;
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::lastNode() const {
+    const Node *node = rootNode();
+    if (!node) {
+        return nullptr;
+    }
+    if (order_ == IN_ORDER) {
+        while (node->greater_child) {
+            node = node->greater_child;
+        }
+    } else if (order_ == REVERSE_ORDER) {
+        while (node->smaller_child) {
+            node = node->smaller_child;
+        }
+    } else if (order_ == PRE_ORDER) {
+        node = preOrderLast(node);
+    }
+    return node;
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::nextNode(const Node *node) const {
+    if (order_ == IN_ORDER) {
+        return inOrderNext(node);
+    }
+    if (order_ == REVERSE_ORDER) {
+        return inOrderPrevious(node);
+    }
+    if (order_ == PRE_ORDER) {
+        if (node->smaller_child) {
+            return node->smaller_child;
+        }
+        if (node->greater_child) {
+            return node->greater_child;
+        }
+        for (; node->parent; node = node->parent) {
+            if (node->parent->smaller_child == node && node->parent->greater_child) {
+                return node->parent->greater_child;
+            }
+        }
+        return nullptr;
+    }
+    const Node *parent = node->parent;
+    if (parent && parent->smaller_child == node && parent->greater_child) {
+        return postOrderFirst(parent->greater_child);
+    }
+    return parent;
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::previousNode(const Node *node) const {
+    if (order_ == IN_ORDER) {
+        return inOrderPrevious(node);
+    }
+    if (order_ == REVERSE_ORDER) {
+        return inOrderNext(node);
+    }
+    if (order_ == PRE_ORDER) {
+        const Node *parent = node->parent;
+        if (parent && parent->greater_child == node && parent->smaller_child) {
+            return preOrderLast(parent->smaller_child);
+        }
+        return parent;
+    }
+    if (node->greater_child) {
+        return node->greater_child;
+    }
+    if (node->smaller_child) {
+        return node->smaller_child;
+    }
+    for (; node->parent; node = node->parent) {
+        if (node->parent->greater_child == node && node->parent->smaller_child) {
+            return node->parent->smaller_child;
+        }
+    }
+    return nullptr;
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::inOrderNext(const Node *node) {
+    if (node->greater_child) {
+        node = node->greater_child;
+        while (node->smaller_child) {
+            node = node->smaller_child;
+        }
+        return node;
+    }
+    while (node->parent && node->parent->greater_child == node) {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::inOrderPrevious(const Node *node) {
+    if (node->smaller_child) {
+        node = node->smaller_child;
+        while (node->greater_child) {
+            node = node->greater_child;
+        }
+        return node;
+    }
+    while (node->parent && node->parent->smaller_child == node) {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::preOrderLast(const Node *node) {
+    while (node->greater_child || node->smaller_child) {
+        node = node->greater_child ? node->greater_child : node->smaller_child;
+    }
+    return node;
+}
+
+template<typename T>
+const BSTNode<T> *Iterator<T>::postOrderFirst(const Node *node) {
+    while (node->smaller_child || node->greater_child) {
+        node = node->smaller_child ? node->smaller_child : node->greater_child;
+    }
+    return node;
 }
 
 #endif  // CONTAINER_BINARY_SEARCH_TREE_H
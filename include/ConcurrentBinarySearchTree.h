@@ -0,0 +1,844 @@
+#ifndef CONTAINER_CONCURRENT_BINARY_SEARCH_TREE_H
+#define CONTAINER_CONCURRENT_BINARY_SEARCH_TREE_H
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <type_traits>
+#include <vector>
+#include "BinarySearchTree.h"
+
+template<typename T, typename Compare = std::less<T>>
+class ConcurrentIterator;
+
+template<typename T, typename Compare = std::less<T>>
+class LockedBinarySearchTree;
+
+// Потокобезопасное AVL-дерево, разбитое на сегменты по диапазонам ключей. Каждый сегмент - отдельное
+// AVL-дерево со своей разделяемой блокировкой, поэтому операции над разными диапазонами ключей
+// не мешают друг другу, а читатели одного сегмента выполняются параллельно. Каталог границ сегментов
+// блокируется монопольно только при разделении переполненного сегмента.
+// Методы возвращают копии элементов, так как ссылки на узлы могут стать недействительными
+template<typename T, typename Compare = std::less<T>>
+class ConcurrentBinarySearchTree {
+public:
+    explicit ConcurrentBinarySearchTree(Compare comparator = Compare());
+//    Конструктор по умолчанию
+
+    explicit ConcurrentBinarySearchTree(BinarySearchTree<T, Compare> &&tree);
+//    Конструктор из обычного дерева (дерево забирается за O(1), если помещается в один сегмент,
+//    иначе разделяется на сегменты за O(n); несбалансированное дерево перестраивается как AVL за O(n))
+
+    ConcurrentBinarySearchTree(const ConcurrentBinarySearchTree<T, Compare> &obj) = delete;
+//    Конструктор копирования (удален, используйте snapshot())
+
+    ~ConcurrentBinarySearchTree() noexcept = default;
+//    Деструктор
+
+    void add(const T &elem);
+//    Добавить элемент
+
+    void clear();
+//    Удалить все элементы
+
+    bool contains(const T &elem) const;
+//    Проверить имеется ли указанный элемент в дереве (блокирует один сегмент)
+
+    size_t countRange(const T &from, const T &to) const;
+//    Количество элементов в полуинтервале [from, to) (блокирует сегменты диапазона)
+
+    template<typename Visitor>
+    void forEachInRange(const T &from, const T &to, Visitor visitor) const;
+//    Посетить по возрастанию элементы полуинтервала [from, to) (под разделяемыми блокировками сегментов диапазона)
+
+    bool isEmpty() const;
+//    Проверить является ли дерево пустым
+
+    ConcurrentIterator<T, Compare> iteratorBegin() const;
+//    Получить итератор по возрастанию на первый элемент
+
+    std::optional<T> lowerBound(const T &elem) const;
+//    Первый элемент, не меньший указанного (или пустое значение)
+
+    T max() const;
+//    Получить максимальный элемент
+
+    T min() const;
+//    Получить минимальный элемент
+
+    T nth(size_t k) const;
+//    Получить k-й по возрастанию элемент (с нуля)
+
+    template<typename Function>
+    auto read(Function function) const;
+//    Вызвать function(const LockedBinarySearchTree &) под разделяемыми блокировками всех сегментов
+
+    size_t rank(const T &elem) const;
+//    Количество элементов, меньших указанного
+
+    void remove(const T &elem);
+//    Удалить элемент
+
+    size_t size() const;
+//    Получить количество элементов в дереве
+
+    BinarySearchTree<T, Compare> snapshot() const;
+//    Получить копию дерева (собирается из сегментов за O(n) под разделяемыми блокировками)
+
+    bool tryAdd(const T &elem);
+//    Добавить элемент, если его еще нет (возвращает, был ли элемент добавлен)
+
+    size_t tryAddMany(const T *arr, size_t size, bool *applied = nullptr);
+//    Добавить массив элементов, монопольно блокируя только затронутые сегменты (возвращает количество добавленных)
+
+    bool tryRemove(const T &elem);
+//    Удалить элемент, если он есть (возвращает, был ли элемент удален)
+
+    size_t tryRemoveMany(const T *arr, size_t size, bool *applied = nullptr);
+//    Удалить массив элементов, монопольно блокируя только затронутые сегменты (возвращает количество удаленных)
+
+    std::optional<T> upperBound(const T &elem) const;
+//    Первый элемент, больший указанного (или пустое значение)
+
+    template<typename Function>
+    auto write(Function function);
+//    Вызвать function(LockedBinarySearchTree &) под монопольными блокировками всех сегментов
+
+    ConcurrentBinarySearchTree<T, Compare> &operator=(const ConcurrentBinarySearchTree<T, Compare> &obj) = delete;
+//    Перегрузка оператора присваивания (удалена)
+
+private:
+    friend class LockedBinarySearchTree<T, Compare>;
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        BinarySearchTree<T, Compare> tree;
+
+        explicit Shard(BinarySearchTree<T, Compare> &&obj) : tree(std::move(obj)) {}
+    };
+
+    using SharedLocks = std::vector<std::shared_lock<std::shared_mutex>>;
+    using UniqueLocks = std::vector<std::unique_lock<std::shared_mutex>>;
+
+    std::vector<std::unique_ptr<Shard>> shards_; // всегда хотя бы один сегмент
+    std::vector<T> bounds_; // bounds_[i] - наименьший допустимый ключ сегмента i + 1
+    mutable std::shared_mutex directory_mutex_; // защищает shards_ и bounds_
+    Compare comparator_;
+
+    static constexpr size_t max_shard_size_ = 2048;
+
+    bool containsLocked(const T &elem) const;
+//    Проверить наличие элемента (вызывающий удерживает блокировку его сегмента)
+
+    size_t countRangeLocked(const T &from, const T &to) const;
+//    Количество элементов в [from, to) (вызывающий удерживает блокировки сегментов диапазона)
+
+    template<typename Visitor>
+    void forEachInRangeLocked(const T &from, const T &to, Visitor &visitor) const;
+//    Посетить элементы [from, to) (вызывающий удерживает блокировки сегментов диапазона)
+
+    std::optional<T> boundLocked(const T &elem, bool upper, size_t shard) const;
+//    Нижняя или верхняя граница в сегменте shard (вызывающий удерживает его блокировку)
+
+    T maxLocked() const;
+//    Максимальный элемент (вызывающий удерживает блокировки всех сегментов)
+
+    T minLocked() const;
+//    Минимальный элемент (вызывающий удерживает блокировки всех сегментов)
+
+    T nthLocked(size_t k) const;
+//    k-й по возрастанию элемент (вызывающий удерживает блокировки всех сегментов)
+
+    size_t rankLocked(const T &elem) const;
+//    Количество элементов, меньших указанного (вызывающий удерживает блокировки сегментов до сегмента elem)
+
+    size_t sizeLocked() const;
+//    Количество элементов (вызывающий удерживает блокировки всех сегментов)
+
+    SharedLocks lockShared(size_t first, size_t last) const;
+//    Разделяемо заблокировать сегменты [first, last] по возрастанию номеров
+
+    UniqueLocks lockUnique(size_t first, size_t last) const;
+//    Монопольно заблокировать сегменты [first, last] по возрастанию номеров
+
+    bool less(const T &a, const T &b) const;
+//    Меньше ли a, чем b, по функции сравнения дерева
+
+    BinarySearchTree<T, Compare> makeShardTree() const;
+//    Пустое AVL-дерево для нового сегмента
+
+    bool oversized() const;
+//    Есть ли переполненный сегмент (вызывающий удерживает каталог)
+
+    size_t shardOf(const T &elem) const;
+//    Номер сегмента, которому принадлежит элемент (вызывающий удерживает каталог)
+
+    size_t modifyMany(const T *arr, size_t size, bool *applied, bool is_remove);
+//    Добавить или удалить массив элементов, блокируя только затронутые сегменты
+
+    void splitIfOversized(bool oversized);
+//    Разделить переполненные сегменты под монопольной блокировкой каталога
+
+    void splitOversized();
+//    Разделить сегменты больше max_shard_size_ на части по max_shard_size_ / 2 (каталог заблокирован монопольно)
+
+    static constexpr bool three_way_ =
+            !std::is_same<std::invoke_result_t<const Compare &, const T &, const T &>, bool>::value;
+};
+
+// Представление дерева, передаваемое в read() и write(): все сегменты уже заблокированы, поэтому несколько
+// операций выполняются атомарно. Через представление нельзя получить ссылки на узлы или внутренние
+// деревья сегментов, а также изменить компаратор или политику балансировки
+template<typename T, typename Compare>
+class LockedBinarySearchTree {
+public:
+    LockedBinarySearchTree(const LockedBinarySearchTree<T, Compare> &obj) = delete;
+//    Конструктор копирования (удален)
+
+    bool contains(const T &elem) const;
+//    Проверить имеется ли указанный элемент в дереве
+
+    size_t countRange(const T &from, const T &to) const;
+//    Количество элементов в полуинтервале [from, to)
+
+    template<typename Visitor>
+    void forEachInRange(const T &from, const T &to, Visitor visitor) const;
+//    Посетить по возрастанию элементы полуинтервала [from, to)
+
+    bool isEmpty() const;
+//    Проверить является ли дерево пустым
+
+    std::optional<T> lowerBound(const T &elem) const;
+//    Первый элемент, не меньший указанного (или пустое значение)
+
+    T max() const;
+//    Получить максимальный элемент
+
+    T min() const;
+//    Получить минимальный элемент
+
+    T nth(size_t k) const;
+//    Получить k-й по возрастанию элемент (с нуля)
+
+    size_t rank(const T &elem) const;
+//    Количество элементов, меньших указанного
+
+    size_t size() const;
+//    Получить количество элементов в дереве
+
+    bool tryAdd(const T &elem);
+//    Добавить элемент, если его еще нет (возвращает, был ли элемент добавлен)
+
+    bool tryRemove(const T &elem);
+//    Удалить элемент, если он есть (возвращает, был ли элемент удален)
+
+    std::optional<T> upperBound(const T &elem) const;
+//    Первый элемент, больший указанного (или пустое значение)
+
+    LockedBinarySearchTree<T, Compare> &operator=(const LockedBinarySearchTree<T, Compare> &obj) = delete;
+//    Перегрузка оператора присваивания (удалена)
+
+private:
+    friend class ConcurrentBinarySearchTree<T, Compare>;
+
+    explicit LockedBinarySearchTree(ConcurrentBinarySearchTree<T, Compare> &tree);
+//    Конструктор (доступен только ConcurrentBinarySearchTree, который удерживает блокировки)
+
+    std::optional<T> bound(const T &elem, bool upper) const;
+//    Нижняя или верхняя граница по всем сегментам
+
+    ConcurrentBinarySearchTree<T, Compare> &tree_;
+};
+
+// Итератор не удерживает блокировку между шагами: каждый шаг заново ищет следующий элемент
+// за O(log n), поэтому писатели не ждут окончания обхода. Итератор хранит копию текущего
+// элемента и видит изменения дерева, сделанные после его создания
+template<typename T, typename Compare>
+class ConcurrentIterator {
+public:
+    ConcurrentIterator() = delete;
+//    Конструктор по умолчанию (удален)
+
+    explicit ConcurrentIterator(const ConcurrentBinarySearchTree<T, Compare> &tree);
+//    Перегрузка конструктора (итератор на минимальный элемент)
+
+    ConcurrentIterator(const ConcurrentIterator<T, Compare> &obj) = default;
+//    Конструктор копирования
+
+    ~ConcurrentIterator() = default;
+//    Деструктор
+
+    bool isEnd() const;
+//    Находится ли итератор на фиктивном элементе, следующем за последним
+
+    void next();
+//    Сместиться на следующий элемент
+
+    const T &value() const;
+//    Получить значение текущего элемента
+
+    ConcurrentIterator<T, Compare> &operator=(const ConcurrentIterator<T, Compare> &obj) = default;
+//    Перегрузка оператора присваивания
+
+    const T &operator*() const;
+//    Перегрузка оператора разыменования
+
+    ConcurrentIterator<T, Compare> &operator++();
+//    Перегрузка оператора префиксного инкремента
+
+private:
+    const ConcurrentBinarySearchTree<T, Compare> *tree_;
+    std::optional<T> value_; // пусто на фиктивном элементе
+};
+
+
+template<typename T, typename Compare>
+ConcurrentBinarySearchTree<T, Compare>::ConcurrentBinarySearchTree(Compare comparator)
+        : comparator_(comparator) {
+    shards_.push_back(std::make_unique<Shard>(makeShardTree()));
+}
+
+template<typename T, typename Compare>
+ConcurrentBinarySearchTree<T, Compare>::ConcurrentBinarySearchTree(BinarySearchTree<T, Compare> &&tree)
+        : comparator_(tree.key_comp()) {
+    tree.setBalance(AVL);
+    shards_.push_back(std::make_unique<Shard>(std::move(tree)));
+    splitOversized();
+}
+
+template<typename T, typename Compare>
+void ConcurrentBinarySearchTree<T, Compare>::add(const T &elem) {
+    if (!tryAdd(elem)) {
+        throw BSTDuplicateValueException("duplicate value to add");
+    }
+}
+
+template<typename T, typename Compare>
+void ConcurrentBinarySearchTree<T, Compare>::clear() {
+    std::unique_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    shards_.clear();
+    bounds_.clear();
+    shards_.push_back(std::make_unique<Shard>(makeShardTree()));
+}
+
+template<typename T, typename Compare>
+bool ConcurrentBinarySearchTree<T, Compare>::contains(const T &elem) const {
+    std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    std::shared_lock<std::shared_mutex> lock(shards_[shardOf(elem)]->mutex);
+    return containsLocked(elem);
+}
+
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::countRange(const T &from, const T &to) const {
+    std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    SharedLocks locks = lockShared(shardOf(from), shardOf(to));
+    return countRangeLocked(from, to);
+}
+
+template<typename T, typename Compare>
+template<typename Visitor>
+void ConcurrentBinarySearchTree<T, Compare>::forEachInRange(const T &from, const T &to, Visitor visitor) const {
+    std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    SharedLocks locks = lockShared(shardOf(from), shardOf(to));
+    forEachInRangeLocked(from, to, visitor);
+}
+
+template<typename T, typename Compare>
+bool ConcurrentBinarySearchTree<T, Compare>::isEmpty() const {
+    return size() == 0;
+}
+
+template<typename T, typename Compare>
+ConcurrentIterator<T, Compare> ConcurrentBinarySearchTree<T, Compare>::iteratorBegin() const {
+    return ConcurrentIterator<T, Compare>(*this);
+}
+
+// Сегменты блокируются по одному по возрастанию и удерживаются до конца поиска,
+// поэтому результат согласован, даже если искомый элемент лежит в одном из следующих сегментов
+template<typename T, typename Compare>
+std::optional<T> ConcurrentBinarySearchTree<T, Compare>::lowerBound(const T &elem) const {
+    std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    SharedLocks locks;
+    for (size_t i = shardOf(elem); i < shards_.size(); i++) {
+        locks.emplace_back(shards_[i]->mutex);
+        std::optional<T> found = boundLocked(elem, false, i);
+        if (found) {
+            return found;
+        }
+    }
+    return std::nullopt;
+}
+
+template<typename T, typename Compare>
+T ConcurrentBinarySearchTree<T, Compare>::max() const {
+    return read([](const LockedBinarySearchTree<T, Compare> &view) { return view.max(); });
+}
+
+template<typename T, typename Compare>
+T ConcurrentBinarySearchTree<T, Compare>::min() const {
+    return read([](const LockedBinarySearchTree<T, Compare> &view) { return view.min(); });
+}
+
+template<typename T, typename Compare>
+T ConcurrentBinarySearchTree<T, Compare>::nth(size_t k) const {
+    return read([k](const LockedBinarySearchTree<T, Compare> &view) { return view.nth(k); });
+}
+
+// Представление только читает дерево, поэтому снятие const с this безопасно
+template<typename T, typename Compare>
+template<typename Function>
+auto ConcurrentBinarySearchTree<T, Compare>::read(Function function) const {
+    std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    SharedLocks locks = lockShared(0, shards_.size() - 1);
+    const LockedBinarySearchTree<T, Compare> view(const_cast<ConcurrentBinarySearchTree<T, Compare> &>(*this));
+    return function(view);
+}
+
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::rank(const T &elem) const {
+    std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    SharedLocks locks = lockShared(0, shardOf(elem));
+    return rankLocked(elem);
+}
+
+template<typename T, typename Compare>
+void ConcurrentBinarySearchTree<T, Compare>::remove(const T &elem) {
+    if (!tryRemove(elem)) {
+        throw BSTNonexistentValueException("nonexistent value to remove");
+    }
+}
+
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::size() const {
+    return read([](const LockedBinarySearchTree<T, Compare> &view) { return view.size(); });
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> ConcurrentBinarySearchTree<T, Compare>::snapshot() const {
+    std::vector<T> values;
+    {
+        std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+        SharedLocks locks = lockShared(0, shards_.size() - 1);
+        values.reserve(sizeLocked());
+        for (const std::unique_ptr<Shard> &shard : shards_) {
+            shard->tree.toArray(std::back_inserter(values));
+        }
+    }
+    return BinarySearchTree<T, Compare>::fromSorted(values.begin(), values.end(), IN_ORDER, comparator_, AVL);
+}
+
+// Поиск и вставка выполняются одним спуском по дереву сегмента под его монопольной блокировкой
+template<typename T, typename Compare>
+bool ConcurrentBinarySearchTree<T, Compare>::tryAdd(const T &elem) {
+    bool added;
+    bool is_oversized;
+    {
+        std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+        Shard &shard = *shards_[shardOf(elem)];
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        added = shard.tree.tryAdd(elem);
+        is_oversized = shard.tree.size() > max_shard_size_;
+    }
+    splitIfOversized(is_oversized);
+    return added;
+}
+
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::tryAddMany(const T *arr, size_t size, bool *applied) {
+    return modifyMany(arr, size, applied, false);
+}
+
+template<typename T, typename Compare>
+bool ConcurrentBinarySearchTree<T, Compare>::tryRemove(const T &elem) {
+    std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    Shard &shard = *shards_[shardOf(elem)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.tree.tryRemove(elem);
+}
+
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::tryRemoveMany(const T *arr, size_t size, bool *applied) {
+    return modifyMany(arr, size, applied, true);
+}
+
+template<typename T, typename Compare>
+std::optional<T> ConcurrentBinarySearchTree<T, Compare>::upperBound(const T &elem) const {
+    std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    SharedLocks locks;
+    for (size_t i = shardOf(elem); i < shards_.size(); i++) {
+        locks.emplace_back(shards_[i]->mutex);
+        std::optional<T> found = boundLocked(elem, true, i);
+        if (found) {
+            return found;
+        }
+    }
+    return std::nullopt;
+}
+
+template<typename T, typename Compare>
+template<typename Function>
+auto ConcurrentBinarySearchTree<T, Compare>::write(Function function) {
+    bool is_oversized;
+    if constexpr (std::is_void<std::invoke_result_t<Function, LockedBinarySearchTree<T, Compare> &>>::value) {
+        {
+            std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+            UniqueLocks locks = lockUnique(0, shards_.size() - 1);
+            LockedBinarySearchTree<T, Compare> view(*this);
+            function(view);
+            is_oversized = oversized();
+        }
+        splitIfOversized(is_oversized);
+    } else {
+        std::optional<std::invoke_result_t<Function, LockedBinarySearchTree<T, Compare> &>> result;
+        {
+            std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+            UniqueLocks locks = lockUnique(0, shards_.size() - 1);
+            LockedBinarySearchTree<T, Compare> view(*this);
+            result.emplace(function(view));
+            is_oversized = oversized();
+        }
+        splitIfOversized(is_oversized);
+        return std::move(*result);
+    }
+}
+
+template<typename T, typename Compare>
+bool ConcurrentBinarySearchTree<T, Compare>::containsLocked(const T &elem) const {
+    return shards_[shardOf(elem)]->tree.contains(elem);
+}
+
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::countRangeLocked(const T &from, const T &to) const {
+    size_t count = 0;
+    for (size_t i = shardOf(from), last = shardOf(to); i <= last; i++) {
+        count += shards_[i]->tree.countRange(from, to);
+    }
+    return count;
+}
+
+template<typename T, typename Compare>
+template<typename Visitor>
+void ConcurrentBinarySearchTree<T, Compare>::forEachInRangeLocked(const T &from, const T &to, Visitor &visitor) const {
+    for (size_t i = shardOf(from), last = shardOf(to); i <= last; i++) {
+        shards_[i]->tree.forEachInRange(from, to, std::ref(visitor));
+    }
+}
+
+template<typename T, typename Compare>
+std::optional<T> ConcurrentBinarySearchTree<T, Compare>::boundLocked(const T &elem, bool upper, size_t shard) const {
+    const BinarySearchTree<T, Compare> &tree = shards_[shard]->tree;
+    Iterator<T> it = upper ? tree.upperBound(elem) : tree.lowerBound(elem);
+    if (it.isEnd()) {
+        return std::nullopt;
+    }
+    return it.value();
+}
+
+template<typename T, typename Compare>
+T ConcurrentBinarySearchTree<T, Compare>::maxLocked() const {
+    for (size_t i = shards_.size(); i > 0; i--) {
+        if (!shards_[i - 1]->tree.isEmpty()) {
+            return shards_[i - 1]->tree.max();
+        }
+    }
+    throw BSTEmptyException("can't find empty tree max value");
+}
+
+template<typename T, typename Compare>
+T ConcurrentBinarySearchTree<T, Compare>::minLocked() const {
+    for (const std::unique_ptr<Shard> &shard : shards_) {
+        if (!shard->tree.isEmpty()) {
+            return shard->tree.min();
+        }
+    }
+    throw BSTEmptyException("can't find empty tree min value");
+}
+
+template<typename T, typename Compare>
+T ConcurrentBinarySearchTree<T, Compare>::nthLocked(size_t k) const {
+    for (const std::unique_ptr<Shard> &shard : shards_) {
+        if (k < shard->tree.size()) {
+            return shard->tree.nth(k);
+        }
+        k -= shard->tree.size();
+    }
+    throw BSTOutOfRangeException("element index out of range");
+}
+
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::rankLocked(const T &elem) const {
+    size_t shard = shardOf(elem);
+    size_t rank = shards_[shard]->tree.rank(elem);
+    for (size_t i = 0; i < shard; i++) {
+        rank += shards_[i]->tree.size();
+    }
+    return rank;
+}
+
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::sizeLocked() const {
+    size_t size = 0;
+    for (const std::unique_ptr<Shard> &shard : shards_) {
+        size += shard->tree.size();
+    }
+    return size;
+}
+
+template<typename T, typename Compare>
+typename ConcurrentBinarySearchTree<T, Compare>::SharedLocks
+ConcurrentBinarySearchTree<T, Compare>::lockShared(size_t first, size_t last) const {
+    SharedLocks locks;
+    for (size_t i = first; i <= last; i++) {
+        locks.emplace_back(shards_[i]->mutex);
+    }
+    return locks;
+}
+
+template<typename T, typename Compare>
+typename ConcurrentBinarySearchTree<T, Compare>::UniqueLocks
+ConcurrentBinarySearchTree<T, Compare>::lockUnique(size_t first, size_t last) const {
+    UniqueLocks locks;
+    for (size_t i = first; i <= last; i++) {
+        locks.emplace_back(shards_[i]->mutex);
+    }
+    return locks;
+}
+
+template<typename T, typename Compare>
+bool ConcurrentBinarySearchTree<T, Compare>::less(const T &a, const T &b) const {
+    if constexpr (three_way_) {
+        return comparator_(a, b) < 0;
+    } else {
+        return comparator_(a, b);
+    }
+}
+
+template<typename T, typename Compare>
+BinarySearchTree<T, Compare> ConcurrentBinarySearchTree<T, Compare>::makeShardTree() const {
+    return BinarySearchTree<T, Compare>(IN_ORDER, comparator_, AVL);
+}
+
+template<typename T, typename Compare>
+bool ConcurrentBinarySearchTree<T, Compare>::oversized() const {
+    for (const std::unique_ptr<Shard> &shard : shards_) {
+        if (shard->tree.size() > max_shard_size_) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::shardOf(const T &elem) const {
+    return std::upper_bound(bounds_.begin(), bounds_.end(), elem, [this](const T &a, const T &b) {
+        return less(a, b);
+    }) - bounds_.begin();
+}
+
+// Элементы группируются по сегментам, затронутые сегменты блокируются монопольно по возрастанию номеров,
+// остальные сегменты остаются доступны другим потокам
+template<typename T, typename Compare>
+size_t ConcurrentBinarySearchTree<T, Compare>::modifyMany(const T *arr, size_t size, bool *applied, bool is_remove) {
+    size_t modified = 0;
+    bool is_oversized = false;
+    {
+        std::shared_lock<std::shared_mutex> directory_lock(directory_mutex_);
+        std::vector<size_t> element_shards(size);
+        std::vector<bool> touched(shards_.size(), false);
+        for (size_t i = 0; i < size; i++) {
+            element_shards[i] = shardOf(arr[i]);
+            touched[element_shards[i]] = true;
+        }
+        UniqueLocks locks;
+        for (size_t i = 0; i < shards_.size(); i++) {
+            if (touched[i]) {
+                locks.emplace_back(shards_[i]->mutex);
+            }
+        }
+        for (size_t i = 0; i < size; i++) {
+            BinarySearchTree<T, Compare> &tree = shards_[element_shards[i]]->tree;
+            bool is_applied = is_remove ? tree.tryRemove(arr[i]) : tree.tryAdd(arr[i]);
+            if (applied) {
+                applied[i] = is_applied;
+            }
+            modified += is_applied;
+            is_oversized = is_oversized || tree.size() > max_shard_size_;
+        }
+    }
+    splitIfOversized(is_oversized);
+    return modified;
+}
+
+template<typename T, typename Compare>
+void ConcurrentBinarySearchTree<T, Compare>::splitIfOversized(bool oversized) {
+    if (!oversized) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> directory_lock(directory_mutex_);
+    splitOversized();
+}
+
+// Под монопольной блокировкой каталога ни один поток не удерживает блокировки сегментов,
+// поэтому сегменты можно заменять без их собственных блокировок
+template<typename T, typename Compare>
+void ConcurrentBinarySearchTree<T, Compare>::splitOversized() {
+    if (!oversized()) {
+        return;
+    }
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<T> bounds;
+    for (size_t i = 0; i < shards_.size(); i++) {
+        if (i > 0) {
+            bounds.push_back(std::move(bounds_[i - 1]));
+        }
+        if (shards_[i]->tree.size() <= max_shard_size_) {
+            shards.push_back(std::move(shards_[i]));
+            continue;
+        }
+        std::vector<T> values;
+        values.reserve(shards_[i]->tree.size());
+        shards_[i]->tree.toArray(std::back_inserter(values));
+        for (size_t first = 0; first < values.size(); first += max_shard_size_ / 2) {
+            size_t last = std::min(values.size(), first + max_shard_size_ / 2);
+            if (first > 0) {
+                bounds.push_back(values[first]);
+            }
+            shards.push_back(std::make_unique<Shard>(BinarySearchTree<T, Compare>::fromSorted(
+                    values.begin() + first, values.begin() + last, IN_ORDER, comparator_, AVL)));
+        }
+    }
+    shards_ = std::move(shards);
+    bounds_ = std::move(bounds);
+}
+
+
+template<typename T, typename Compare>
+LockedBinarySearchTree<T, Compare>::LockedBinarySearchTree(ConcurrentBinarySearchTree<T, Compare> &tree)
+        : tree_(tree) {}
+
+template<typename T, typename Compare>
+bool LockedBinarySearchTree<T, Compare>::contains(const T &elem) const {
+    return tree_.containsLocked(elem);
+}
+
+template<typename T, typename Compare>
+size_t LockedBinarySearchTree<T, Compare>::countRange(const T &from, const T &to) const {
+    return tree_.countRangeLocked(from, to);
+}
+
+template<typename T, typename Compare>
+template<typename Visitor>
+void LockedBinarySearchTree<T, Compare>::forEachInRange(const T &from, const T &to, Visitor visitor) const {
+    tree_.forEachInRangeLocked(from, to, visitor);
+}
+
+template<typename T, typename Compare>
+bool LockedBinarySearchTree<T, Compare>::isEmpty() const {
+    return tree_.sizeLocked() == 0;
+}
+
+template<typename T, typename Compare>
+std::optional<T> LockedBinarySearchTree<T, Compare>::lowerBound(const T &elem) const {
+    return bound(elem, false);
+}
+
+template<typename T, typename Compare>
+T LockedBinarySearchTree<T, Compare>::max() const {
+    return tree_.maxLocked();
+}
+
+template<typename T, typename Compare>
+T LockedBinarySearchTree<T, Compare>::min() const {
+    return tree_.minLocked();
+}
+
+template<typename T, typename Compare>
+T LockedBinarySearchTree<T, Compare>::nth(size_t k) const {
+    return tree_.nthLocked(k);
+}
+
+template<typename T, typename Compare>
+size_t LockedBinarySearchTree<T, Compare>::rank(const T &elem) const {
+    return tree_.rankLocked(elem);
+}
+
+template<typename T, typename Compare>
+size_t LockedBinarySearchTree<T, Compare>::size() const {
+    return tree_.sizeLocked();
+}
+
+template<typename T, typename Compare>
+bool LockedBinarySearchTree<T, Compare>::tryAdd(const T &elem) {
+    return tree_.shards_[tree_.shardOf(elem)]->tree.tryAdd(elem);
+}
+
+template<typename T, typename Compare>
+bool LockedBinarySearchTree<T, Compare>::tryRemove(const T &elem) {
+    return tree_.shards_[tree_.shardOf(elem)]->tree.tryRemove(elem);
+}
+
+template<typename T, typename Compare>
+std::optional<T> LockedBinarySearchTree<T, Compare>::upperBound(const T &elem) const {
+    return bound(elem, true);
+}
+
+template<typename T, typename Compare>
+std::optional<T> LockedBinarySearchTree<T, Compare>::bound(const T &elem, bool upper) const {
+    for (size_t i = tree_.shardOf(elem); i < tree_.shards_.size(); i++) {
+        std::optional<T> found = tree_.boundLocked(elem, upper, i);
+        if (found) {
+            return found;
+        }
+    }
+    return std::nullopt;
+}
+
+
+template<typename T, typename Compare>
+ConcurrentIterator<T, Compare>::ConcurrentIterator(const ConcurrentBinarySearchTree<T, Compare> &tree) {
+    tree_ = &tree;
+    value_ = tree.read([](const LockedBinarySearchTree<T, Compare> &view) -> std::optional<T> {
+        if (view.isEmpty()) {
+            return std::nullopt;
+        }
+        return view.min();
+    });
+}
+
+template<typename T, typename Compare>
+bool ConcurrentIterator<T, Compare>::isEnd() const {
+    return !value_;
+}
+
+template<typename T, typename Compare>
+void ConcurrentIterator<T, Compare>::next() {
+    if (isEnd()) {
+        throw BSTIteratorOutOfRangeException("iterator out of range");
+    }
+    value_ = tree_->upperBound(*value_);
+}
+
+template<typename T, typename Compare>
+const T &ConcurrentIterator<T, Compare>::value() const {
+    if (isEnd()) {
+        throw BSTIteratorAccessingEndValueException("end value to access");
+    }
+    return *value_;
+}
+
+template<typename T, typename Compare>
+const T &ConcurrentIterator<T, Compare>::operator*() const {
+    return value();
+}
+
+template<typename T, typename Compare>
+ConcurrentIterator<T, Compare> &ConcurrentIterator<T, Compare>::operator++() {
+    next();
+    return *this;
+}
+
+#endif //CONTAINER_CONCURRENT_BINARY_SEARCH_TREE_H
@@ -0,0 +1,518 @@
+#ifndef CONTAINER_FROZEN_BINARY_SEARCH_TREE_H
+#define CONTAINER_FROZEN_BINARY_SEARCH_TREE_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include "BSTException.h"
+#include "BSTFile.h"
+#include "BSTIteratorException.h"
+
+template<typename T>
+class FrozenIterator;
+
+template<typename T, typename Compare = std::less<T>>
+class FrozenBinarySearchTree;
+
+// Неизменяемое дерево поиска без указателей: элементы лежат в массиве в порядке Эйтцингера
+// (корень в ячейке 1, потомки ячейки k - в ячейках 2k и 2k + 1). Спуск вычисляет следующую
+// ячейку арифметически, без ветвлений по результату сравнения, и заранее подгружает в кэш
+// ячейки на несколько уровней ниже. Копии дерева разделяют неизменяемые ячейки
+template<typename T, typename Compare>
+class FrozenBinarySearchTree {
+public:
+    explicit FrozenBinarySearchTree(Compare comparator = Compare());
+//    Конструктор по умолчанию (пустое дерево)
+
+    template<typename InputIt>
+    FrozenBinarySearchTree(InputIt sorted, size_t size, Compare comparator = Compare());
+//    Построить дерево из size строго возрастающих элементов за O(n)
+
+    FrozenBinarySearchTree(const FrozenBinarySearchTree<T, Compare> &obj) = default;
+//    Конструктор копирования (за O(1), ячейки общие)
+
+    bool contains(const T &elem) const;
+//    Проверить имеется ли указанный элемент в дереве
+
+    bool isEmpty() const;
+//    Проверить является ли дерево пустым
+
+    FrozenIterator<T> iteratorBegin() const;
+//    Получить итератор по возрастанию на минимальный элемент
+
+    FrozenIterator<T> iteratorEnd() const;
+//    Получить итератор на фиктивный элемент, следующий за последним
+
+    static FrozenBinarySearchTree<T, Compare> map(const std::string &path, Compare comparator = Compare());
+//    Открыть файл, записанный save, без копирования: ячейки читаются прямо из отображенного в память файла
+
+    const T *lowerBound(const T &elem) const;
+//    Первый элемент, не меньший указанного (nullptr, если такого нет)
+
+    const T &max() const;
+//    Получить максимальный элемент
+
+    const T &min() const;
+//    Получить минимальный элемент
+
+    size_t size() const;
+//    Получить количество элементов в дереве
+
+    void save(const std::string &path) const;
+//    Записать ячейки в файл как есть (для побайтово копируемых T)
+
+    T *toArray() const;
+//    Получить массив элементов по возрастанию (память освобождается вызывающим через delete [])
+
+    const T *upperBound(const T &elem) const;
+//    Первый элемент, больший указанного (nullptr, если такого нет)
+
+    FrozenBinarySearchTree<T, Compare> &operator=(const FrozenBinarySearchTree<T, Compare> &obj) = default;
+//    Перегрузка оператора присваивания (за O(1), ячейки общие)
+
+    template<typename _T, typename _Compare>
+    friend std::ostream &operator<<(std::ostream &os, const FrozenBinarySearchTree<_T, _Compare> &obj);
+//    Перегрузка оператора вывода на поток
+
+private:
+    template<typename>
+    friend class FrozenIterator;
+
+    static size_t firstIndex(size_t size);
+//    Ячейка минимального элемента (0 для пустого дерева)
+
+    static size_t lastIndex(size_t size);
+//    Ячейка максимального элемента (0 для пустого дерева)
+
+    template<typename A, typename B>
+    bool less(const A &a, const B &b) const;
+//    Меньше ли a, чем b, по функции сравнения дерева
+
+    template<bool upper>
+    size_t boundIndex(const T &elem) const;
+//    Ячейка первого элемента, не меньшего (upper = false) или большего (upper = true) указанного (0, если такого нет)
+
+    static size_t nextIndex(size_t index, size_t size);
+//    Ячейка следующего по возрастанию элемента (0 после максимального)
+
+    static size_t previousIndex(size_t index, size_t size);
+//    Ячейка предыдущего по возрастанию элемента (0 перед минимальным)
+
+    static void prefetch(const T *address);
+//    Подсказать процессору загрузить ячейку в кэш
+
+    std::shared_ptr<const T> storage_; // владелец ячеек: массив в памяти или отображенный файл
+    const T *cells_; // ячейка k хранится в cells_[k - 1]
+    size_t size_;
+    Compare comparator_;
+
+    // потомки ячейки k через log2(prefetch_stride_) уровней занимают подряд ячейки [k * stride, (k + 1) * stride)
+    static constexpr size_t prefetch_stride_ = std::max<size_t>(1, 64 / sizeof(T));
+    static constexpr bool three_way_ =
+            !std::is_same<std::invoke_result_t<const Compare &, const T &, const T &>, bool>::value;
+};
+
+
+template<typename T, typename Compare>
+FrozenBinarySearchTree<T, Compare>::FrozenBinarySearchTree(Compare comparator) {
+    cells_ = nullptr;
+    size_ = 0;
+    comparator_ = comparator;
+}
+
+// Ячейки обходятся в порядке возрастания, поэтому входные элементы читаются ровно один раз
+template<typename T, typename Compare>
+template<typename InputIt>
+FrozenBinarySearchTree<T, Compare>::FrozenBinarySearchTree(InputIt sorted, size_t size, Compare comparator) {
+    T *cells = size ? new T[size] : nullptr;
+    storage_ = std::shared_ptr<const T>(cells, std::default_delete<const T[]>());
+    cells_ = cells;
+    size_ = size;
+    comparator_ = comparator;
+    size_t previous = 0;
+    for (size_t index = firstIndex(size); index; index = nextIndex(index, size), ++sorted) {
+        cells[index - 1] = *sorted;
+        if (previous && !less(cells[previous - 1], cells[index - 1])) {
+            throw BSTUnsortedValuesException("values to freeze are not strictly sorted");
+        }
+        previous = index;
+    }
+}
+
+template<typename T, typename Compare>
+bool FrozenBinarySearchTree<T, Compare>::contains(const T &elem) const {
+    size_t index = boundIndex<false>(elem);
+    return index && !less(elem, cells_[index - 1]);
+}
+
+template<typename T, typename Compare>
+bool FrozenBinarySearchTree<T, Compare>::isEmpty() const {
+    return !size_;
+}
+
+template<typename T, typename Compare>
+FrozenIterator<T> FrozenBinarySearchTree<T, Compare>::iteratorBegin() const {
+    return FrozenIterator<T>(*this);
+}
+
+template<typename T, typename Compare>
+FrozenIterator<T> FrozenBinarySearchTree<T, Compare>::iteratorEnd() const {
+    FrozenIterator<T> it(*this);
+    it.end();
+    return it;
+}
+
+template<typename T, typename Compare>
+const T *FrozenBinarySearchTree<T, Compare>::lowerBound(const T &elem) const {
+    size_t index = boundIndex<false>(elem);
+    return index ? &cells_[index - 1] : nullptr;
+}
+
+// Порядок ячеек не проверяется, чтобы не читать файл целиком: файл должен быть записан save
+template<typename T, typename Compare>
+FrozenBinarySearchTree<T, Compare> FrozenBinarySearchTree<T, Compare>::map(const std::string &path,
+                                                                          Compare comparator) {
+    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable elements can be mapped");
+    static_assert(alignof(T) <= sizeof(BSTFileHeader), "elements after the file header must be aligned");
+    size_t length;
+    std::shared_ptr<const char> mapping = BSTFile::map(path, length);
+    if (length < sizeof(BSTFileHeader)) {
+        throw BSTFileException("truncated file header");
+    }
+    BSTFileHeader header;
+    std::memcpy(&header, mapping.get(), sizeof(header));
+    BSTFile::checkHeader(header, EYTZINGER_LAYOUT, sizeof(T));
+    if ((length - sizeof(header)) / sizeof(T) < header.count) {
+        throw BSTFileException("truncated file");
+    }
+
+    FrozenBinarySearchTree<T, Compare> tree(comparator);
+    if (header.count) {
+        tree.cells_ = reinterpret_cast<const T *>(mapping.get() + sizeof(header));
+        tree.storage_ = std::shared_ptr<const T>(mapping, tree.cells_);
+        tree.size_ = static_cast<size_t>(header.count);
+    }
+    return tree;
+}
+
+template<typename T, typename Compare>
+const T &FrozenBinarySearchTree<T, Compare>::max() const {
+    if (isEmpty()) {
+        throw BSTEmptyException("can't find empty tree max value");
+    }
+    return cells_[lastIndex(size_) - 1];
+}
+
+template<typename T, typename Compare>
+const T &FrozenBinarySearchTree<T, Compare>::min() const {
+    if (isEmpty()) {
+        throw BSTEmptyException("can't find empty tree min value");
+    }
+    return cells_[firstIndex(size_) - 1];
+}
+
+template<typename T, typename Compare>
+size_t FrozenBinarySearchTree<T, Compare>::size() const {
+    return size_;
+}
+
+template<typename T, typename Compare>
+T *FrozenBinarySearchTree<T, Compare>::toArray() const {
+    if (isEmpty()) {
+        throw BSTEmptyException("can't convert empty tree");
+    }
+    T *arr = new T[size()];
+    T *out = arr;
+    for (size_t index = firstIndex(size_); index; index = nextIndex(index, size_)) {
+        *out++ = cells_[index - 1];
+    }
+    return arr;
+}
+
+template<typename T, typename Compare>
+void FrozenBinarySearchTree<T, Compare>::save(const std::string &path) const {
+    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable elements can be saved as cells");
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    BSTFile::writeHeader(file, BSTFile::makeHeader(EYTZINGER_LAYOUT, sizeof(T), size_));
+    BSTSerializer<T>::write(file, cells_, size_);
+    if (!file.flush()) {
+        throw BSTFileException("can't write file " + path);
+    }
+}
+
+template<typename T, typename Compare>
+const T *FrozenBinarySearchTree<T, Compare>::upperBound(const T &elem) const {
+    size_t index = boundIndex<true>(elem);
+    return index ? &cells_[index - 1] : nullptr;
+}
+
+template<typename _T, typename _Compare>
+std::ostream &operator<<(std::ostream &os, const FrozenBinarySearchTree<_T, _Compare> &obj) {
+    os << "{";
+    for (FrozenIterator<_T> it = obj.iteratorBegin(); !it.isEnd(); it.next()) {
+        if (it.hasPrevious()) {
+            os << ", ";
+        }
+        os << *it;
+    }
+    os << "}";
+    return os;
+}
+
+template<typename T, typename Compare>
+size_t FrozenBinarySearchTree<T, Compare>::firstIndex(size_t size) {
+    if (!size) {
+        return 0;
+    }
+    size_t index = 1;
+    while (index * 2 <= size) {
+        index *= 2;
+    }
+    return index;
+}
+
+template<typename T, typename Compare>
+size_t FrozenBinarySearchTree<T, Compare>::lastIndex(size_t size) {
+    if (!size) {
+        return 0;
+    }
+    size_t index = 1;
+    while (index * 2 + 1 <= size) {
+        index = index * 2 + 1;
+    }
+    return index;
+}
+
+template<typename T, typename Compare>
+template<typename A, typename B>
+bool FrozenBinarySearchTree<T, Compare>::less(const A &a, const B &b) const {
+    if constexpr (three_way_) {
+        return comparator_(a, b) < 0;
+    } else {
+        return comparator_(a, b);
+    }
+}
+
+// Спуск всегда проходит до листа: номер ячейки накапливает в битах путь (1 - направо),
+// а ответ - последняя ячейка, из которой спуск ушел налево, т. е. номер без хвоста
+// из единиц и одного нуля перед ним
+template<typename T, typename Compare>
+template<bool upper>
+size_t FrozenBinarySearchTree<T, Compare>::boundIndex(const T &elem) const {
+    size_t index = 1;
+    while (index <= size_) {
+        prefetch(cells_ + std::min(index * prefetch_stride_, size_) - 1);
+        if constexpr (upper) {
+            index = index * 2 + !less(elem, cells_[index - 1]);
+        } else {
+            index = index * 2 + less(cells_[index - 1], elem);
+        }
+    }
+    while (index & 1) {
+        index >>= 1;
+    }
+    return index >> 1;
+}
+
+template<typename T, typename Compare>
+size_t FrozenBinarySearchTree<T, Compare>::nextIndex(size_t index, size_t size) {
+    if (index * 2 + 1 <= size) {
+        index = index * 2 + 1;
+        while (index * 2 <= size) {
+            index *= 2;
+        }
+        return index;
+    }
+    while (index & 1) {
+        index >>= 1;
+    }
+    return index >> 1;
+}
+
+template<typename T, typename Compare>
+size_t FrozenBinarySearchTree<T, Compare>::previousIndex(size_t index, size_t size) {
+    if (index * 2 <= size) {
+        index *= 2;
+        while (index * 2 + 1 <= size) {
+            index = index * 2 + 1;
+        }
+        return index;
+    }
+    while (index && !(index & 1)) {
+        index >>= 1;
+    }
+    return index >> 1;
+}
+
+template<typename T, typename Compare>
+void FrozenBinarySearchTree<T, Compare>::prefetch(const T *address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void) address;
+#endif
+}
+
+
+// Итератор по возрастанию хранит только номер ячейки и не копирует элементы,
+// действителен, пока живо дерево
+template<typename T>
+class FrozenIterator {
+public:
+    FrozenIterator() = delete;
+//    Конструктор по умолчанию (удален)
+
+    template<typename Compare>
+    explicit FrozenIterator(const FrozenBinarySearchTree<T, Compare> &tree);
+//    Перегрузка конструктора (итератор на минимальный элемент)
+
+    FrozenIterator(const FrozenIterator<T> &obj) = default;
+//    Конструктор копирования
+
+    ~FrozenIterator() = default;
+//    Деструктор
+
+    FrozenIterator<T> &begin();
+//    Сместиться на минимальный элемент
+
+    FrozenIterator<T> &end();
+//    Сместиться на фиктивный элемент, следующий за последним
+
+    bool hasNext() const;
+//    Имеет ли итератор следующий элемент (в т. ч. фиктивный)
+
+    bool hasPrevious() const;
+//    Имеет ли итератор предыдущий элемент
+
+    bool isEnd() const;
+//    Находится ли итератор на фиктивном элементе, следующем за последним
+
+    void next();
+//    Сместиться на следующий элемент
+
+    void previous();
+//    Сместиться на предыдущий элемент
+
+    const T &value() const;
+//    Получить значение текущего элемента
+
+    FrozenIterator<T> &operator=(const FrozenIterator<T> &obj) = default;
+//    Перегрузка оператора присваивания
+
+    FrozenIterator<T> &operator++();
+//    Перегрузка оператора префиксного инкремента
+
+    FrozenIterator<T> &operator--();
+//    Перегрузка оператора префиксного декремента
+
+    const T &operator*() const;
+//    Перегрузка оператора разыменования
+
+    bool operator==(const FrozenIterator<T> &it) const;
+//    Перегрузка оператора равенства
+
+    bool operator!=(const FrozenIterator<T> &it) const;
+//    Перегрузка оператора неравенства
+
+private:
+    using Tree = FrozenBinarySearchTree<T>;
+
+    const T *cells_;
+    size_t size_;
+    size_t index_; // 0 - фиктивный элемент
+};
+
+
+template<typename T>
+template<typename Compare>
+FrozenIterator<T>::FrozenIterator(const FrozenBinarySearchTree<T, Compare> &tree) {
+    cells_ = tree.cells_;
+    size_ = tree.size();
+    begin();
+}
+
+template<typename T>
+FrozenIterator<T> &FrozenIterator<T>::begin() {
+    index_ = Tree::firstIndex(size_);
+    return *this;
+}
+
+template<typename T>
+FrozenIterator<T> &FrozenIterator<T>::end() {
+    index_ = 0;
+    return *this;
+}
+
+template<typename T>
+bool FrozenIterator<T>::hasNext() const {
+    return index_;
+}
+
+template<typename T>
+bool FrozenIterator<T>::hasPrevious() const {
+    return size_ && index_ != Tree::firstIndex(size_);
+}
+
+template<typename T>
+bool FrozenIterator<T>::isEnd() const {
+    return !index_;
+}
+
+template<typename T>
+void FrozenIterator<T>::next() {
+    if (!hasNext()) {
+        throw BSTIteratorOutOfRangeException("iterator out of range");
+    }
+    index_ = Tree::nextIndex(index_, size_);
+}
+
+template<typename T>
+void FrozenIterator<T>::previous() {
+    if (!hasPrevious()) {
+        throw BSTIteratorOutOfRangeException("iterator out of range");
+    }
+    index_ = index_ ? Tree::previousIndex(index_, size_) : Tree::lastIndex(size_);
+}
+
+template<typename T>
+const T &FrozenIterator<T>::value() const {
+    if (isEnd()) {
+        throw BSTIteratorAccessingEndValueException("end value to access");
+    }
+    return cells_[index_ - 1];
+}
+
+template<typename T>
+FrozenIterator<T> &FrozenIterator<T>::operator++() {
+    next();
+    return *this;
+}
+
+template<typename T>
+FrozenIterator<T> &FrozenIterator<T>::operator--() {
+    previous();
+    return *this;
+}
+
+template<typename T>
+const T &FrozenIterator<T>::operator*() const {
+    return value();
+}
+
+template<typename T>
+bool FrozenIterator<T>::operator==(const FrozenIterator<T> &it) const {
+    return cells_ == it.cells_ && index_ == it.index_;
+}
+
+template<typename T>
+bool FrozenIterator<T>::operator!=(const FrozenIterator<T> &it) const {
+    return !(*this == it);
+}
+
+#endif //CONTAINER_FROZEN_BINARY_SEARCH_TREE_H
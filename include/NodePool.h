@@ -0,0 +1,177 @@
+#ifndef CONTAINER_NODE_POOL_H
+#define CONTAINER_NODE_POOL_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Пул узлов: узлы выделяются из непрерывных блоков, освобожденные узлы
+// переиспользуются, а все блоки освобождаются разом методом clear()
+template<typename Node>
+class NodePool {
+public:
+    NodePool();
+//    Конструктор по умолчанию
+
+    NodePool(const NodePool<Node> &obj) = delete;
+//    Конструктор копирования (удален, у каждого дерева свой пул)
+
+    NodePool(NodePool<Node> &&obj) noexcept;
+//    Конструктор переноса (забирает блоки obj)
+
+    ~NodePool() noexcept = default;
+//    Деструктор (не вызывает деструкторы узлов)
+
+    Node *allocate(size_t count);
+//    Выделить count подряд идущих неинициализированных слотов (узлы создаются в них вызывающим)
+
+    void clear();
+//    Освободить все блоки (деструкторы узлов должны быть вызваны заранее)
+
+    template<typename... Args>
+    Node *create(Args &&... args);
+//    Выделить и инициализировать узел
+
+    void destroy(Node *node);
+//    Вызвать деструктор узла и вернуть его память в пул
+
+    void reserve(size_t count);
+//    Гарантировать, что следующие count новых узлов будут выделены без новых блоков
+//    (новый блок добавляется только на недостающую часть)
+
+    NodePool<Node> &operator=(const NodePool<Node> &obj) = delete;
+//    Перегрузка оператора присваивания (удалена)
+
+    NodePool<Node> &operator=(NodePool<Node> &&obj) noexcept;
+//    Перегрузка оператора присваивания с переносом (забирает блоки obj)
+
+private:
+    using Slot = std::aligned_storage_t<sizeof(Node), alignof(Node)>;
+
+    struct Chunk {
+        std::unique_ptr<Slot[]> slots;
+        size_t capacity;
+    };
+
+    void addChunk(size_t capacity);
+//    Добавить новый блок (свободный остаток последнего блока переходит в список освобожденных слотов)
+
+    void grow();
+//    Добавить новый блок (вдвое больший предыдущего)
+
+    static constexpr size_t min_chunk_capacity_ = 32;
+    static constexpr size_t max_chunk_capacity_ = 65536;
+
+    std::vector<Chunk> chunks_;
+    size_t used_; // занято слотов в последнем блоке
+    Slot *free_list_; // освобожденные слоты хранят указатель на следующий
+};
+
+
+template<typename Node>
+NodePool<Node>::NodePool() {
+    used_ = 0;
+    free_list_ = nullptr;
+}
+
+template<typename Node>
+NodePool<Node>::NodePool(NodePool<Node> &&obj) noexcept {
+    chunks_ = std::move(obj.chunks_);
+    used_ = obj.used_;
+    free_list_ = obj.free_list_;
+    obj.clear();
+}
+
+template<typename Node>
+Node *NodePool<Node>::allocate(size_t count) {
+    static_assert(sizeof(Slot) == sizeof(Node), "slots must be laid out as an array of nodes");
+    if (!count) {
+        return nullptr;
+    }
+    if (chunks_.empty() || chunks_.back().capacity - used_ < count) {
+        addChunk(std::max(count, min_chunk_capacity_));
+    }
+    Slot *slots = &chunks_.back().slots[used_];
+    used_ += count;
+    return reinterpret_cast<Node *>(slots);
+}
+
+template<typename Node>
+void NodePool<Node>::clear() {
+    chunks_.clear();
+    used_ = 0;
+    free_list_ = nullptr;
+}
+
+template<typename Node>
+template<typename... Args>
+Node *NodePool<Node>::create(Args &&... args) {
+    Slot *slot = free_list_;
+    if (slot) {
+        free_list_ = *reinterpret_cast<Slot **>(slot);
+    } else {
+        if (chunks_.empty() || used_ == chunks_.back().capacity) {
+            grow();
+        }
+        slot = &chunks_.back().slots[used_++];
+    }
+    return new(slot) Node{std::forward<Args>(args)...};
+}
+
+template<typename Node>
+void NodePool<Node>::destroy(Node *node) {
+    node->~Node();
+    Slot *slot = reinterpret_cast<Slot *>(node);
+    *reinterpret_cast<Slot **>(slot) = free_list_;
+    free_list_ = slot;
+}
+
+template<typename Node>
+void NodePool<Node>::reserve(size_t count) {
+    size_t available = chunks_.empty() ? 0 : chunks_.back().capacity - used_;
+    if (available >= count) {
+        return;
+    }
+    addChunk(std::max(count - available, min_chunk_capacity_));
+}
+
+template<typename Node>
+NodePool<Node> &NodePool<Node>::operator=(NodePool<Node> &&obj) noexcept {
+    if (this == &obj) {
+        return *this;
+    }
+    chunks_ = std::move(obj.chunks_);
+    used_ = obj.used_;
+    free_list_ = obj.free_list_;
+    obj.clear();
+    return *this;
+}
+
+template<typename Node>
+void NodePool<Node>::addChunk(size_t capacity) {
+    if (!chunks_.empty()) {
+        Chunk &last = chunks_.back();
+        for (size_t i = last.capacity; i > used_; i--) {
+            Slot *slot = &last.slots[i - 1];
+            *reinterpret_cast<Slot **>(slot) = free_list_;
+            free_list_ = slot;
+        }
+    }
+    chunks_.push_back({std::unique_ptr<Slot[]>(new Slot[capacity]), capacity});
+    used_ = 0;
+}
+
+template<typename Node>
+void NodePool<Node>::grow() {
+    size_t capacity = min_chunk_capacity_;
+    if (!chunks_.empty()) {
+        capacity = std::min(chunks_.back().capacity * 2, max_chunk_capacity_);
+    }
+    addChunk(capacity);
+}
+
+#endif //CONTAINER_NODE_POOL_H
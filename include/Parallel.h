@@ -0,0 +1,76 @@
+#ifndef CONTAINER_PARALLEL_H
+#define CONTAINER_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Выполнить task(i) для всех i из [0, tasks) в threads потоках (включая вызывающий).
+// Задачи раздаются по одной, первое исключение пробрасывается после завершения всех потоков
+template<typename Task>
+void parallelFor(size_t tasks, size_t threads, Task task) {
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&]() {
+        for (size_t i = next++; i < tasks; i = next++) {
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t count = std::min(threads, tasks);
+    for (size_t i = 1; i < count; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Отсортировать [first, last) в threads потоках: части сортируются независимо,
+// затем попарно сливаются (каждый раунд слияний тоже выполняется параллельно)
+template<typename RandomIt, typename Less>
+void parallelSort(RandomIt first, RandomIt last, Less less, size_t threads) {
+    size_t size = std::distance(first, last);
+    if (threads <= 1 || size < threads * 2) {
+        std::sort(first, last, less);
+        return;
+    }
+    std::vector<size_t> bounds(threads + 1);
+    for (size_t i = 0; i <= threads; i++) {
+        bounds[i] = size * i / threads;
+    }
+    parallelFor(threads, threads, [&](size_t part) {
+        std::sort(first + bounds[part], first + bounds[part + 1], less);
+    });
+    for (size_t width = 1; width < threads; width *= 2) {
+        size_t merges = (threads + width * 2 - 1) / (width * 2);
+        parallelFor(merges, threads, [&](size_t merge) {
+            size_t low = merge * width * 2;
+            size_t middle = std::min(low + width, threads);
+            size_t high = std::min(low + width * 2, threads);
+            if (middle < high) {
+                std::inplace_merge(first + bounds[low], first + bounds[middle], first + bounds[high], less);
+            }
+        });
+    }
+}
+
+#endif //CONTAINER_PARALLEL_H
@@ -0,0 +1,816 @@
+#ifndef CONTAINER_SNAPSHOT_BINARY_SEARCH_TREE_H
+#define CONTAINER_SNAPSHOT_BINARY_SEARCH_TREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "BSTException.h"
+#include "BSTIteratorException.h"
+#include "NodePool.h"
+
+template<typename T, typename Compare = std::less<T>>
+class SnapshotBinarySearchTree;
+
+template<typename T, typename Compare = std::less<T>>
+class TreeSnapshot;
+
+template<typename T, typename Compare = std::less<T>>
+class SnapshotIterator;
+
+// Узел неизменяем после публикации, поэтому ссылок на родителя нет: версии дерева разделяют ветки
+template<typename T>
+struct PersistentNode {
+    const PersistentNode<T> *smaller_child;
+    const PersistentNode<T> *greater_child;
+    size_t count; // количество элементов в ветке
+    int height;
+    T value;
+};
+
+// Персистентное AVL-дерево: писатель копирует путь от корня до измененного узла и атомарно
+// публикует новый корень, читатели обходят неизменную версию без блокировок и атомарных операций
+// на каждом узле. Замененные узлы освобождаются по эпохам, когда их не может видеть ни один снимок
+template<typename T, typename Compare>
+class SnapshotBinarySearchTree {
+public:
+    explicit SnapshotBinarySearchTree(Compare comparator = Compare());
+//    Конструктор по умолчанию
+
+    SnapshotBinarySearchTree(const SnapshotBinarySearchTree<T, Compare> &obj) = delete;
+//    Конструктор копирования (удален)
+
+    ~SnapshotBinarySearchTree() noexcept;
+//    Деструктор (снимки дерева должны быть уничтожены заранее)
+
+    void add(const T &elem);
+//    Добавить элемент
+
+    void clear();
+//    Удалить все элементы
+
+    bool contains(const T &elem) const;
+//    Проверить имеется ли указанный элемент в дереве (занимает слот читателя на время вызова,
+//    для серии запросов выгоднее один раз получить snapshot())
+
+    bool isEmpty() const;
+//    Проверить является ли дерево пустым (одно чтение корня, без слота читателя)
+
+    void remove(const T &elem);
+//    Удалить элемент
+
+    size_t size() const;
+//    Получить количество элементов в дереве (одно чтение счетчика, без слота читателя)
+
+    TreeSnapshot<T, Compare> snapshot() const;
+//    Получить неизменный снимок текущей версии дерева
+
+    bool tryAdd(const T &elem);
+//    Добавить элемент, если его еще нет (возвращает, был ли элемент добавлен)
+
+    size_t tryAddMany(const T *arr, size_t size, bool *applied = nullptr);
+//    Добавить массив элементов одной публикацией (возвращает количество добавленных)
+
+    bool tryRemove(const T &elem);
+//    Удалить элемент, если он есть (возвращает, был ли элемент удален)
+
+    size_t tryRemoveMany(const T *arr, size_t size, bool *applied = nullptr);
+//    Удалить массив элементов одной публикацией (возвращает количество удаленных)
+
+    SnapshotBinarySearchTree<T, Compare> &operator=(const SnapshotBinarySearchTree<T, Compare> &obj) = delete;
+//    Перегрузка оператора присваивания (удалена)
+
+private:
+    using Node = PersistentNode<T>;
+
+    friend class TreeSnapshot<T, Compare>;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{0}; // 0 - слот свободен
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        const Node *node;
+    };
+
+    const Node *balance(const T &value, const Node *smaller, const Node *greater);
+//    Создать узел со значением value и ветками, при необходимости выполнив поворот
+
+    static size_t countOf(const Node *node);
+//    Количество элементов в ветке (0 для отсутствующей ветки)
+
+    void dealloc(const Node *node);
+//    Вызвать деструкторы всех узлов ветки
+
+    static int heightOf(const Node *node);
+//    Высота ветки (0 для отсутствующей ветки)
+
+    const Node *insertBranch(const Node *node, const T &elem, bool &inserted);
+//    Получить новую версию ветки с добавленным элементом (узлы старого пути помечаются замененными)
+
+    template<typename A, typename B>
+    bool less(const A &a, const B &b) const;
+//    Меньше ли a, чем b, по функции сравнения дерева
+
+    const Node *makeNode(const T &value, const Node *smaller, const Node *greater);
+//    Создать узел с указанными ветками
+
+    ReaderSlot *pin() const;
+//    Занять слот читателя текущей эпохой (когда все основные слоты заняты - дополнительный слот под мьютексом)
+
+    void publish(const Node *root);
+//    Опубликовать новый корень и передать замененные узлы в очередь на освобождение
+
+    void reclaim();
+//    Освободить замененные узлы, которые не видит ни один снимок
+
+    const Node *removeBranch(const Node *node, const T &elem, bool &removed);
+//    Получить новую версию ветки без указанного элемента
+
+    const Node *removeMinElement(const Node *node, const Node *&min);
+//    Получить новую версию ветки без минимального элемента
+
+    void retire(const Node *node);
+//    Пометить узел замененным текущей операцией
+
+    std::atomic<const Node *> root_;
+    std::atomic<size_t> size_; // количество элементов опубликованной версии
+    mutable std::atomic<uint64_t> epoch_;
+    std::unique_ptr<ReaderSlot[]> slots_;
+    mutable std::mutex overflow_mutex_;
+    mutable std::deque<ReaderSlot> overflow_slots_; // адреса слотов не меняются при добавлении
+
+    std::mutex writer_mutex_;
+    NodePool<Node> pool_;
+    std::vector<const Node *> replaced_; // заменены текущей операцией, еще видны старым снимкам
+    std::vector<Retired> retired_;
+
+    Compare comparator_;
+
+    static constexpr size_t reader_slots_ = 128;
+    static constexpr size_t reclaim_threshold_ = 256;
+    static constexpr bool three_way_ =
+            !std::is_same<std::invoke_result_t<const Compare &, const T &, const T &>, bool>::value;
+};
+
+// Снимок удерживает эпоху, поэтому узлы его версии не освобождаются, пока он существует.
+// Все запросы к снимку работают только с обычными указателями
+template<typename T, typename Compare>
+class TreeSnapshot {
+public:
+    TreeSnapshot() = delete;
+//    Конструктор по умолчанию (удален)
+
+    TreeSnapshot(const TreeSnapshot<T, Compare> &obj) = delete;
+//    Конструктор копирования (удален)
+
+    TreeSnapshot(TreeSnapshot<T, Compare> &&obj) noexcept;
+//    Конструктор переноса (obj перестает удерживать эпоху)
+
+    ~TreeSnapshot() noexcept;
+//    Деструктор (освобождает эпоху)
+
+    bool contains(const T &elem) const;
+//    Проверить имеется ли указанный элемент в снимке
+
+    bool isEmpty() const;
+//    Проверить является ли снимок пустым
+
+    SnapshotIterator<T, Compare> iteratorBegin() const;
+//    Получить итератор по возрастанию на первый элемент
+
+    const T *lowerBound(const T &elem) const;
+//    Первый элемент, не меньший указанного (nullptr, если такого нет)
+
+    const T &max() const;
+//    Получить максимальный элемент
+
+    const T &min() const;
+//    Получить минимальный элемент
+
+    const T &nth(size_t k) const;
+//    Получить k-й по возрастанию элемент (с нуля)
+
+    size_t rank(const T &elem) const;
+//    Количество элементов, меньших указанного
+
+    size_t size() const;
+//    Получить количество элементов в снимке
+
+    const T *upperBound(const T &elem) const;
+//    Первый элемент, больший указанного (nullptr, если такого нет)
+
+    TreeSnapshot<T, Compare> &operator=(const TreeSnapshot<T, Compare> &obj) = delete;
+//    Перегрузка оператора присваивания (удалена)
+
+private:
+    using Node = PersistentNode<T>;
+    using Tree = SnapshotBinarySearchTree<T, Compare>;
+
+    friend class SnapshotBinarySearchTree<T, Compare>;
+
+    friend class SnapshotIterator<T, Compare>;
+
+    TreeSnapshot(const Tree *tree, typename Tree::ReaderSlot *slot, const Node *root);
+//    Перегрузка конструктора (снимок занятого слота)
+
+    const T *bound(const T &elem, bool upper) const;
+//    Первый элемент, не меньший (upper = false) или больший (upper = true) указанного
+
+    const Tree *tree_;
+    typename Tree::ReaderSlot *slot_;
+    const Node *root_;
+};
+
+// Итератор по возрастанию хранит путь от корня (O(log n) памяти) и действителен, пока жив снимок
+template<typename T, typename Compare>
+class SnapshotIterator {
+public:
+    SnapshotIterator() = delete;
+//    Конструктор по умолчанию (удален)
+
+    explicit SnapshotIterator(const TreeSnapshot<T, Compare> &snapshot);
+//    Перегрузка конструктора (итератор на минимальный элемент)
+
+    SnapshotIterator(const SnapshotIterator<T, Compare> &obj) = default;
+//    Конструктор копирования
+
+    ~SnapshotIterator() = default;
+//    Деструктор
+
+    bool isEnd() const;
+//    Находится ли итератор на фиктивном элементе, следующем за последним
+
+    void next();
+//    Сместиться на следующий элемент
+
+    const T &value() const;
+//    Получить значение текущего элемента
+
+    SnapshotIterator<T, Compare> &operator=(const SnapshotIterator<T, Compare> &obj) = default;
+//    Перегрузка оператора присваивания
+
+    const T &operator*() const;
+//    Перегрузка оператора разыменования
+
+    SnapshotIterator<T, Compare> &operator++();
+//    Перегрузка оператора префиксного инкремента
+
+private:
+    using Node = PersistentNode<T>;
+
+    void pushSmallerPath(const Node *node);
+//    Добавить в путь узел и всех его меньших потомков
+
+    std::vector<const Node *> path_; // вершина - текущий узел
+};
+
+
+template<typename T, typename Compare>
+SnapshotBinarySearchTree<T, Compare>::SnapshotBinarySearchTree(Compare comparator)
+        : root_(nullptr), size_(0), epoch_(1), slots_(new ReaderSlot[reader_slots_]), comparator_(comparator) {}
+
+template<typename T, typename Compare>
+SnapshotBinarySearchTree<T, Compare>::~SnapshotBinarySearchTree() noexcept {
+    if constexpr (!std::is_trivially_destructible<T>::value) {
+        dealloc(root_.load());
+        for (Retired &retired : retired_) {
+            pool_.destroy(const_cast<Node *>(retired.node));
+        }
+    }
+    pool_.clear();
+}
+
+template<typename T, typename Compare>
+void SnapshotBinarySearchTree<T, Compare>::add(const T &elem) {
+    if (!tryAdd(elem)) {
+        throw BSTDuplicateValueException("duplicate value to add");
+    }
+}
+
+template<typename T, typename Compare>
+void SnapshotBinarySearchTree<T, Compare>::clear() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    const Node *root = root_.load();
+    if (!root) {
+        return;
+    }
+    std::vector<const Node *> stack = {root};
+    while (!stack.empty()) {
+        const Node *node = stack.back();
+        stack.pop_back();
+        if (node->smaller_child) {
+            stack.push_back(node->smaller_child);
+        }
+        if (node->greater_child) {
+            stack.push_back(node->greater_child);
+        }
+        retire(node);
+    }
+    publish(nullptr);
+}
+
+template<typename T, typename Compare>
+bool SnapshotBinarySearchTree<T, Compare>::contains(const T &elem) const {
+    return snapshot().contains(elem);
+}
+
+// Узлы не разыменовываются, поэтому слот читателя не нужен
+template<typename T, typename Compare>
+bool SnapshotBinarySearchTree<T, Compare>::isEmpty() const {
+    return !root_.load(std::memory_order_acquire);
+}
+
+template<typename T, typename Compare>
+void SnapshotBinarySearchTree<T, Compare>::remove(const T &elem) {
+    if (!tryRemove(elem)) {
+        throw BSTNonexistentValueException("nonexistent value to remove");
+    }
+}
+
+template<typename T, typename Compare>
+size_t SnapshotBinarySearchTree<T, Compare>::size() const {
+    return size_.load(std::memory_order_acquire);
+}
+
+template<typename T, typename Compare>
+TreeSnapshot<T, Compare> SnapshotBinarySearchTree<T, Compare>::snapshot() const {
+    ReaderSlot *slot = pin();
+    return TreeSnapshot<T, Compare>(this, slot, root_.load());
+}
+
+template<typename T, typename Compare>
+bool SnapshotBinarySearchTree<T, Compare>::tryAdd(const T &elem) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    bool inserted = false;
+    const Node *root = insertBranch(root_.load(), elem, inserted);
+    if (inserted) {
+        publish(root);
+    }
+    return inserted;
+}
+
+template<typename T, typename Compare>
+size_t SnapshotBinarySearchTree<T, Compare>::tryAddMany(const T *arr, size_t size, bool *applied) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    const Node *root = root_.load();
+    size_t added = 0;
+    for (size_t i = 0; i < size; i++) {
+        bool inserted = false;
+        root = insertBranch(root, arr[i], inserted);
+        if (applied) {
+            applied[i] = inserted;
+        }
+        added += inserted;
+    }
+    if (added) {
+        publish(root);
+    }
+    return added;
+}
+
+template<typename T, typename Compare>
+bool SnapshotBinarySearchTree<T, Compare>::tryRemove(const T &elem) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    bool removed = false;
+    const Node *root = removeBranch(root_.load(), elem, removed);
+    if (removed) {
+        publish(root);
+    }
+    return removed;
+}
+
+template<typename T, typename Compare>
+size_t SnapshotBinarySearchTree<T, Compare>::tryRemoveMany(const T *arr, size_t size, bool *applied) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    const Node *root = root_.load();
+    size_t removed = 0;
+    for (size_t i = 0; i < size; i++) {
+        bool is_removed = false;
+        root = removeBranch(root, arr[i], is_removed);
+        if (applied) {
+            applied[i] = is_removed;
+        }
+        removed += is_removed;
+    }
+    if (removed) {
+        publish(root);
+    }
+    return removed;
+}
+
+template<typename T, typename Compare>
+const PersistentNode<T> *SnapshotBinarySearchTree<T, Compare>::balance(const T &value, const Node *smaller,
+                                                                       const Node *greater) {
+    int smaller_height = heightOf(smaller);
+    int greater_height = heightOf(greater);
+    if (smaller_height > greater_height + 1) {
+        if (heightOf(smaller->smaller_child) >= heightOf(smaller->greater_child)) {
+            retire(smaller);
+            return makeNode(smaller->value, smaller->smaller_child,
+                            makeNode(value, smaller->greater_child, greater));
+        }
+        const Node *middle = smaller->greater_child;
+        retire(smaller);
+        retire(middle);
+        return makeNode(middle->value, makeNode(smaller->value, smaller->smaller_child, middle->smaller_child),
+                        makeNode(value, middle->greater_child, greater));
+    }
+    if (greater_height > smaller_height + 1) {
+        if (heightOf(greater->greater_child) >= heightOf(greater->smaller_child)) {
+            retire(greater);
+            return makeNode(greater->value, makeNode(value, smaller, greater->smaller_child),
+                            greater->greater_child);
+        }
+        const Node *middle = greater->smaller_child;
+        retire(greater);
+        retire(middle);
+        return makeNode(middle->value, makeNode(value, smaller, middle->smaller_child),
+                        makeNode(greater->value, middle->greater_child, greater->greater_child));
+    }
+    return makeNode(value, smaller, greater);
+}
+
+template<typename T, typename Compare>
+size_t SnapshotBinarySearchTree<T, Compare>::countOf(const Node *node) {
+    return node ? node->count : 0;
+}
+
+template<typename T, typename Compare>
+void SnapshotBinarySearchTree<T, Compare>::dealloc(const Node *node) {
+    if (!node) {
+        return;
+    }
+    std::vector<const Node *> stack = {node};
+    while (!stack.empty()) {
+        const Node *current = stack.back();
+        stack.pop_back();
+        if (current->smaller_child) {
+            stack.push_back(current->smaller_child);
+        }
+        if (current->greater_child) {
+            stack.push_back(current->greater_child);
+        }
+        pool_.destroy(const_cast<Node *>(current));
+    }
+}
+
+template<typename T, typename Compare>
+int SnapshotBinarySearchTree<T, Compare>::heightOf(const Node *node) {
+    return node ? node->height : 0;
+}
+
+// Глубина рекурсии ограничена высотой AVL-дерева
+template<typename T, typename Compare>
+const PersistentNode<T> *SnapshotBinarySearchTree<T, Compare>::insertBranch(const Node *node, const T &elem,
+                                                                            bool &inserted) {
+    if (!node) {
+        inserted = true;
+        return makeNode(elem, nullptr, nullptr);
+    }
+    if (less(elem, node->value)) {
+        const Node *smaller = insertBranch(node->smaller_child, elem, inserted);
+        if (!inserted) {
+            return node;
+        }
+        retire(node);
+        return balance(node->value, smaller, node->greater_child);
+    }
+    if (less(node->value, elem)) {
+        const Node *greater = insertBranch(node->greater_child, elem, inserted);
+        if (!inserted) {
+            return node;
+        }
+        retire(node);
+        return balance(node->value, node->smaller_child, greater);
+    }
+    return node;
+}
+
+template<typename T, typename Compare>
+template<typename A, typename B>
+bool SnapshotBinarySearchTree<T, Compare>::less(const A &a, const B &b) const {
+    if constexpr (three_way_) {
+        return comparator_(a, b) < 0;
+    } else {
+        return comparator_(a, b);
+    }
+}
+
+template<typename T, typename Compare>
+const PersistentNode<T> *SnapshotBinarySearchTree<T, Compare>::makeNode(const T &value, const Node *smaller,
+                                                                        const Node *greater) {
+    return pool_.create(smaller, greater, countOf(smaller) + countOf(greater) + 1,
+                        std::max(heightOf(smaller), heightOf(greater)) + 1, value);
+}
+
+// Слот занимается до чтения корня: писатель, не увидевший слот, уже опубликовал корень,
+// из которого освобождаемые узлы недостижимы
+// Если заняты все основные слоты, используются дополнительные: их занимают и просматривает писатель под мьютексом
+template<typename T, typename Compare>
+typename SnapshotBinarySearchTree<T, Compare>::ReaderSlot *SnapshotBinarySearchTree<T, Compare>::pin() const {
+    size_t first = std::hash<std::thread::id>()(std::this_thread::get_id()) % reader_slots_;
+    for (size_t i = 0; i < reader_slots_; i++) {
+        ReaderSlot &slot = slots_[(first + i) % reader_slots_];
+        uint64_t free = 0;
+        if (!slot.epoch.load(std::memory_order_relaxed) &&
+            slot.epoch.compare_exchange_strong(free, epoch_.load())) {
+            return &slot;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(overflow_mutex_);
+    for (ReaderSlot &slot : overflow_slots_) {
+        uint64_t free = 0;
+        if (slot.epoch.compare_exchange_strong(free, epoch_.load())) {
+            return &slot;
+        }
+    }
+    ReaderSlot &slot = overflow_slots_.emplace_back();
+    slot.epoch.store(epoch_.load());
+    return &slot;
+}
+
+template<typename T, typename Compare>
+void SnapshotBinarySearchTree<T, Compare>::publish(const Node *root) {
+    size_.store(countOf(root), std::memory_order_release);
+    root_.store(root);
+    uint64_t epoch = epoch_.fetch_add(1);
+    for (const Node *node : replaced_) {
+        retired_.push_back({epoch, node});
+    }
+    replaced_.clear();
+    if (retired_.size() >= reclaim_threshold_) {
+        reclaim();
+    }
+}
+
+// Узел, замененный в эпоху e, может видеть только снимок, занявший слот эпохой не позже e
+template<typename T, typename Compare>
+void SnapshotBinarySearchTree<T, Compare>::reclaim() {
+    uint64_t oldest = epoch_.load();
+    for (size_t i = 0; i < reader_slots_; i++) {
+        uint64_t epoch = slots_[i].epoch.load();
+        if (epoch && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        for (const ReaderSlot &slot : overflow_slots_) {
+            uint64_t epoch = slot.epoch.load();
+            if (epoch && epoch < oldest) {
+                oldest = epoch;
+            }
+        }
+    }
+    auto alive = std::partition(retired_.begin(), retired_.end(), [oldest](const Retired &retired) {
+        return retired.epoch >= oldest;
+    });
+    for (auto it = alive; it != retired_.end(); ++it) {
+        pool_.destroy(const_cast<Node *>(it->node));
+    }
+    retired_.erase(alive, retired_.end());
+}
+
+template<typename T, typename Compare>
+const PersistentNode<T> *SnapshotBinarySearchTree<T, Compare>::removeBranch(const Node *node, const T &elem,
+                                                                            bool &removed) {
+    if (!node) {
+        return nullptr;
+    }
+    if (less(elem, node->value)) {
+        const Node *smaller = removeBranch(node->smaller_child, elem, removed);
+        if (!removed) {
+            return node;
+        }
+        retire(node);
+        return balance(node->value, smaller, node->greater_child);
+    }
+    if (less(node->value, elem)) {
+        const Node *greater = removeBranch(node->greater_child, elem, removed);
+        if (!removed) {
+            return node;
+        }
+        retire(node);
+        return balance(node->value, node->smaller_child, greater);
+    }
+
+    removed = true;
+    retire(node);
+    if (!node->smaller_child) {
+        return node->greater_child;
+    }
+    if (!node->greater_child) {
+        return node->smaller_child;
+    }
+    const Node *successor = nullptr;
+    const Node *greater = removeMinElement(node->greater_child, successor);
+    return balance(successor->value, node->smaller_child, greater);
+}
+
+template<typename T, typename Compare>
+const PersistentNode<T> *SnapshotBinarySearchTree<T, Compare>::removeMinElement(const Node *node, const Node *&min) {
+    retire(node);
+    if (!node->smaller_child) {
+        min = node;
+        return node->greater_child;
+    }
+    const Node *smaller = removeMinElement(node->smaller_child, min);
+    return balance(node->value, smaller, node->greater_child);
+}
+
+template<typename T, typename Compare>
+void SnapshotBinarySearchTree<T, Compare>::retire(const Node *node) {
+    replaced_.push_back(node);
+}
+
+
+template<typename T, typename Compare>
+TreeSnapshot<T, Compare>::TreeSnapshot(TreeSnapshot<T, Compare> &&obj) noexcept {
+    tree_ = obj.tree_;
+    slot_ = obj.slot_;
+    root_ = obj.root_;
+    obj.slot_ = nullptr;
+    obj.root_ = nullptr;
+}
+
+template<typename T, typename Compare>
+TreeSnapshot<T, Compare>::~TreeSnapshot() noexcept {
+    if (slot_) {
+        slot_->epoch.store(0);
+    }
+}
+
+template<typename T, typename Compare>
+bool TreeSnapshot<T, Compare>::contains(const T &elem) const {
+    const Node *candidate = nullptr;
+    for (const Node *node = root_; node;) {
+        if (tree_->less(elem, node->value)) {
+            node = node->smaller_child;
+        } else {
+            candidate = node;
+            node = node->greater_child;
+        }
+    }
+    return candidate && !tree_->less(candidate->value, elem);
+}
+
+template<typename T, typename Compare>
+bool TreeSnapshot<T, Compare>::isEmpty() const {
+    return !root_;
+}
+
+template<typename T, typename Compare>
+SnapshotIterator<T, Compare> TreeSnapshot<T, Compare>::iteratorBegin() const {
+    return SnapshotIterator<T, Compare>(*this);
+}
+
+template<typename T, typename Compare>
+const T *TreeSnapshot<T, Compare>::lowerBound(const T &elem) const {
+    return bound(elem, false);
+}
+
+template<typename T, typename Compare>
+const T &TreeSnapshot<T, Compare>::max() const {
+    if (isEmpty()) {
+        throw BSTEmptyException("can't find empty tree max value");
+    }
+    const Node *node = root_;
+    while (node->greater_child) {
+        node = node->greater_child;
+    }
+    return node->value;
+}
+
+template<typename T, typename Compare>
+const T &TreeSnapshot<T, Compare>::min() const {
+    if (isEmpty()) {
+        throw BSTEmptyException("can't find empty tree min value");
+    }
+    const Node *node = root_;
+    while (node->smaller_child) {
+        node = node->smaller_child;
+    }
+    return node->value;
+}
+
+template<typename T, typename Compare>
+const T &TreeSnapshot<T, Compare>::nth(size_t k) const {
+    if (k >= size()) {
+        throw BSTOutOfRangeException("element index out of range");
+    }
+    const Node *node = root_;
+    while (true) {
+        size_t smaller = Tree::countOf(node->smaller_child);
+        if (k < smaller) {
+            node = node->smaller_child;
+        } else if (k > smaller) {
+            k -= smaller + 1;
+            node = node->greater_child;
+        } else {
+            return node->value;
+        }
+    }
+}
+
+template<typename T, typename Compare>
+size_t TreeSnapshot<T, Compare>::rank(const T &elem) const {
+    size_t rank = 0;
+    for (const Node *node = root_; node;) {
+        if (tree_->less(node->value, elem)) {
+            rank += Tree::countOf(node->smaller_child) + 1;
+            node = node->greater_child;
+        } else {
+            node = node->smaller_child;
+        }
+    }
+    return rank;
+}
+
+template<typename T, typename Compare>
+size_t TreeSnapshot<T, Compare>::size() const {
+    return Tree::countOf(root_);
+}
+
+template<typename T, typename Compare>
+const T *TreeSnapshot<T, Compare>::upperBound(const T &elem) const {
+    return bound(elem, true);
+}
+
+template<typename T, typename Compare>
+TreeSnapshot<T, Compare>::TreeSnapshot(const Tree *tree, typename Tree::ReaderSlot *slot, const Node *root) {
+    tree_ = tree;
+    slot_ = slot;
+    root_ = root;
+}
+
+template<typename T, typename Compare>
+const T *TreeSnapshot<T, Compare>::bound(const T &elem, bool upper) const {
+    const Node *found = nullptr;
+    for (const Node *node = root_; node;) {
+        if (upper ? !tree_->less(elem, node->value) : tree_->less(node->value, elem)) {
+            node = node->greater_child;
+        } else {
+            found = node;
+            node = node->smaller_child;
+        }
+    }
+    return found ? &found->value : nullptr;
+}
+
+
+template<typename T, typename Compare>
+SnapshotIterator<T, Compare>::SnapshotIterator(const TreeSnapshot<T, Compare> &snapshot) {
+    pushSmallerPath(snapshot.root_);
+}
+
+template<typename T, typename Compare>
+bool SnapshotIterator<T, Compare>::isEnd() const {
+    return path_.empty();
+}
+
+template<typename T, typename Compare>
+void SnapshotIterator<T, Compare>::next() {
+    if (isEnd()) {
+        throw BSTIteratorOutOfRangeException("iterator out of range");
+    }
+    const Node *node = path_.back();
+    path_.pop_back();
+    pushSmallerPath(node->greater_child);
+}
+
+template<typename T, typename Compare>
+const T &SnapshotIterator<T, Compare>::value() const {
+    if (isEnd()) {
+        throw BSTIteratorAccessingEndValueException("end value to access");
+    }
+    return path_.back()->value;
+}
+
+template<typename T, typename Compare>
+const T &SnapshotIterator<T, Compare>::operator*() const {
+    return value();
+}
+
+template<typename T, typename Compare>
+SnapshotIterator<T, Compare> &SnapshotIterator<T, Compare>::operator++() {
+    next();
+    return *this;
+}
+
+template<typename T, typename Compare>
+void SnapshotIterator<T, Compare>::pushSmallerPath(const Node *node) {
+    for (; node; node = node->smaller_child) {
+        path_.push_back(node);
+    }
+}
+
+#endif //CONTAINER_SNAPSHOT_BINARY_SEARCH_TREE_H
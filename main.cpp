@@ -1,6 +1,15 @@
 #include "BinarySearchTree.h"
+#include "BTreeSet.h"
+#include "ConcurrentBinarySearchTree.h"
+#include "SnapshotBinarySearchTree.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 int custom_comparator(int a, int b) {
     if (a < b) {
@@ -42,9 +51,26 @@ int main() {
               << std::endl; // testing contains()
     std::cout << "must be               1" << std::endl;
 
+    std::cout << "first_tree nth(1) = " << first_tree.nth(1) << std::endl; // testing nth()
+    std::cout << "must be             4" << std::endl;
+
+    std::cout << "first_tree rank(6) = " << first_tree.rank(6) << std::endl; // testing rank()
+    std::cout << "must be              3" << std::endl;
+
+    std::cout << "first_tree countRange(3, 7) = " << first_tree.countRange(3, 7)
+              << std::endl; // testing countRange()
+    std::cout << "must be                       3" << std::endl;
+
+    std::cout << "first_tree upperBound(5) = " << *first_tree.upperBound(5)
+              << std::endl; // testing upperBound()
+    std::cout << "must be                    6" << std::endl;
+
     auto second_tree = BinarySearchTree<int>(IN_ORDER);
     int numbers_to_add2[] = {5, 2, 8};
     second_tree.addMany(numbers_to_add2, 3);
+    std::cout << "second_tree tryAdd = " << second_tree.tryAdd(5) << std::endl; // testing tryAdd()
+    std::cout << "must be              0" << std::endl;
+
     std::cout << "first_tree contains second = " << first_tree.contains(second_tree)
               << std::endl; // testing contains() for trees
     std::cout << "must be                      1" << std::endl;
@@ -97,11 +123,11 @@ int main() {
     std::cout << std::endl;
     std::cout << "must be           1 2 5 8" << std::endl;
 
-    second_tree.setComparator(custom_comparator); // testing setComparator
-    second_tree.clear();
-    second_tree.addMany(array_from_tree, 4);
-    std::cout << "second_tree = " << second_tree << std::endl;
-    std::cout << "must be       {8, 5, 2, 1}" << std::endl;
+    auto fifth_tree = BinarySearchTree<int, DynamicComparator<int>>(IN_ORDER);
+    fifth_tree.setComparator(custom_comparator); // testing setComparator
+    fifth_tree.addMany(array_from_tree, 4);
+    std::cout << "fifth_tree = " << fifth_tree << std::endl;
+    std::cout << "must be      {8, 5, 2, 1}" << std::endl;
 
     fourth_tree.setOrder(IN_ORDER); // testing setOrder
     std::cout << "fourth_tree = " << fourth_tree << std::endl;
@@ -116,6 +142,12 @@ int main() {
     std::cout << "fourth_tree = " << fourth_tree << std::endl;
     std::cout << "must be       {8, 5, 2, 1}" << std::endl;
 
+    int sorted_numbers[] = {1, 3, 5, 7, 9};
+    auto sorted_tree = BinarySearchTree<int>::fromSorted(sorted_numbers, sorted_numbers + 5,
+                                                         PRE_ORDER); // testing fromSorted()
+    std::cout << "sorted_tree = " << sorted_tree << std::endl;
+    std::cout << "must be       {5, 3, 1, 9, 7}" << std::endl;
+
 
     auto it = *fourth_tree.iteratorBegin(); // testing constructor & iteratorBegin()
 
@@ -190,6 +222,108 @@ int main() {
     std::cout << "iterator = " << *it_subtract << std::endl;
     std::cout << "must be    8" << std::endl;
 
+    ConcurrentBinarySearchTree<int> concurrent_tree;
+    std::vector<std::thread> workers;
+    for (int worker = 0; worker < 4; worker++) {
+        workers.emplace_back([&concurrent_tree, worker]() {
+            for (int i = 0; i < 100; i++) {
+                concurrent_tree.tryAdd(worker * 100 + i); // testing concurrent tryAdd()
+                concurrent_tree.contains(i); // testing concurrent contains()
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    std::cout << "concurrent_tree size = " << concurrent_tree.size() << std::endl;
+    std::cout << "must be                400" << std::endl;
+
+    auto it_concurrent = concurrent_tree.iteratorBegin(); // testing concurrent iterator
+    ++it_concurrent;
+    std::cout << "concurrent iterator = " << *it_concurrent << std::endl;
+    std::cout << "must be               1" << std::endl;
+
+    SnapshotBinarySearchTree<int> snapshot_tree;
+    int snapshot_values[] = {3, 1, 2};
+    snapshot_tree.tryAddMany(snapshot_values, 3);
+    {
+        auto snapshot = snapshot_tree.snapshot(); // testing snapshot()
+        snapshot_tree.remove(2);
+        std::cout << "snapshot contains = " << snapshot.contains(2) << snapshot_tree.contains(2) << std::endl;
+        std::cout << "must be             10" << std::endl;
+
+        auto it_snapshot = snapshot.iteratorBegin(); // testing snapshot iterator
+        ++it_snapshot;
+        std::cout << "snapshot iterator = " << *it_snapshot << std::endl;
+        std::cout << "must be             2" << std::endl;
+    }
+
+    BTreeSet<int> b_tree(POST_ORDER); // testing BTreeSet
+    for (int i = 10; i > 0; i--) {
+        b_tree.add(i);
+    }
+    b_tree.remove(5);
+    std::cout << "b_tree min, max, size = " << b_tree.min() << " " << b_tree.max() << " " << b_tree.size() << std::endl;
+    std::cout << "must be                 1 10 9" << std::endl;
+    std::cout << "b_tree nth, rank, lowerBound = " << b_tree.nth(4) << " " << b_tree.rank(7) << " "
+              << *b_tree.lowerBound(5) << std::endl; // testing BTreeSet order statistics
+    std::cout << "must be                        6 5 6" << std::endl;
+
+    auto frozen_tree = sorted_tree.freeze(); // testing freeze()
+    std::cout << "frozen_tree = " << frozen_tree << " " << *frozen_tree.lowerBound(6) << std::endl;
+    std::cout << "must be       {1, 3, 5, 7, 9} 7" << std::endl;
+
+    sorted_tree.save("sorted_tree.bin"); // testing save() & load()
+    auto loaded_tree = BinarySearchTree<int>::load("sorted_tree.bin", PRE_ORDER);
+    std::remove("sorted_tree.bin");
+    std::cout << "loaded_tree = " << loaded_tree << std::endl;
+    std::cout << "must be       {5, 3, 1, 9, 7}" << std::endl;
+
+    std::cout << "batches = "; // testing forEachBatch()
+    sorted_tree.forEachBatch(2, IN_ORDER, [](const int *batch, size_t size) {
+        std::cout << "[" << batch[0] << (size > 1 ? ", " + std::to_string(batch[1]) : "") << "]";
+    });
+    std::cout << std::endl;
+    std::cout << "must be   [1, 3][5, 7][9]" << std::endl;
+
+    Iterator<int> sorted_begin(sorted_tree, IN_ORDER), sorted_end = Iterator<int>(sorted_tree, IN_ORDER).end();
+    std::cout << "std::lower_bound = " << *std::lower_bound(sorted_begin, sorted_end, 4) // testing iterator_traits
+              << " " << sorted_end - sorted_begin << std::endl;
+    std::cout << "must be            5 5" << std::endl;
+
+    std::cout << "range-for = "; // testing begin() & end()
+    for (int value : sorted_tree) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl;
+    std::cout << "must be     5 3 1 9 7 " << std::endl;
+
+    auto inserted = sorted_tree.insert(4); // testing insert(), find() & erase()
+    sorted_tree.erase(sorted_tree.find(3)); // 3 has two children, iterator on 4 stays valid
+    std::cout << "inserted = " << *inserted.first << inserted.second << " " << sorted_tree << std::endl;
+    std::cout << "must be    41 {5, 4, 1, 9, 7}" << std::endl;
+
+    auto hinted = sorted_tree.insert(sorted_tree.find(4), 2); // testing insert() with hint
+    sorted_tree.erase(hinted);
+    std::cout << "hinted = " << *sorted_tree.insert(sorted_tree.end(), 8) << " " << sorted_tree.size() << std::endl;
+    std::cout << "must be  8 6" << std::endl;
+
+    BinarySearchTree<std::string, std::less<>> words; // testing transparent find(), count() & lower_bound()
+    words.insert("pear");
+    words.insert("apple");
+    std::cout << "transparent = " << *words.find(std::string_view("pear")) << " " << words.count(std::string_view("fig"))
+              << " " << *words.lower_bound(std::string_view("b")) << std::endl;
+    std::cout << "must be       pear 0 pear" << std::endl;
+
+    BinarySearchTree<int> empty_tree; // testing parallel bulk operations on empty trees
+    empty_tree.setParallelism(4, 0);
+    BinarySearchTree<int> empty_copy(empty_tree);
+    auto empty_union = empty_tree.unionWith(empty_copy);
+    auto empty_intersection = empty_tree.intersectionWith(sorted_tree);
+    std::cout << "parallel empty = " << empty_copy.size() << empty_union.size() << empty_intersection.size()
+              << " " << empty_union << std::endl;
+    std::cout << "must be          000 {}" << std::endl;
+
     std::cout << "--- TESTING FINISHED ---" << std::endl;
 
     delete [] array_from_tree;
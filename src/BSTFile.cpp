@@ -0,0 +1,107 @@
+#include "BSTFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(BSTFileHeader) == 64, "file header must occupy 64 bytes");
+
+static const char file_magic[8] = "BSTFILE";
+static const uint32_t file_version = 1;
+static const uint32_t file_byte_order = 0x01020304;
+
+void BSTFile::checkHeader(const BSTFileHeader &header, file_layout layout, size_t element_size) {
+    if (std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0) {
+        throw BSTFileException("not a tree file");
+    }
+    if (header.version != file_version) {
+        throw BSTFileException("unsupported file version");
+    }
+    if (header.byte_order != file_byte_order) {
+        throw BSTFileException("file was written with another byte order");
+    }
+    if (header.layout != layout) {
+        throw BSTFileException("unexpected file layout");
+    }
+    if (header.element_size != element_size) {
+        throw BSTFileException("element size mismatch");
+    }
+}
+
+BSTFileHeader BSTFile::makeHeader(file_layout layout, size_t element_size, size_t count) {
+    BSTFileHeader header{};
+    std::memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version = file_version;
+    header.byte_order = file_byte_order;
+    header.layout = layout;
+    header.element_size = static_cast<uint32_t>(element_size);
+    header.count = count;
+    return header;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+std::shared_ptr<const char> BSTFile::map(const std::string &path, size_t &length) {
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw BSTFileException("can't open file " + path);
+    }
+    struct stat info{};
+    if (fstat(file, &info) != 0) {
+        close(file);
+        throw BSTFileException("can't read file " + path);
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (!length) {
+        close(file);
+        throw BSTFileException("empty file " + path);
+    }
+    void *address = mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (address == MAP_FAILED) {
+        throw BSTFileException("can't map file " + path);
+    }
+    return std::shared_ptr<const char>(static_cast<const char *>(address), [length](const char *data) {
+        munmap(const_cast<char *>(data), length);
+    });
+}
+
+#else
+
+std::shared_ptr<const char> BSTFile::map(const std::string &path, size_t &length) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw BSTFileException("can't open file " + path);
+    }
+    length = static_cast<size_t>(file.tellg());
+    if (!length) {
+        throw BSTFileException("empty file " + path);
+    }
+    // буфер выделяется с выравниванием заголовка, чтобы элементы после него были выровнены
+    auto data = std::shared_ptr<char>(static_cast<char *>(::operator new(length, std::align_val_t(64))),
+                                      [](char *data) { ::operator delete(data, std::align_val_t(64)); });
+    file.seekg(0);
+    if (!file.read(data.get(), static_cast<std::streamsize>(length))) {
+        throw BSTFileException("can't read file " + path);
+    }
+    return data;
+}
+
+#endif
+
+void BSTFile::readHeader(std::istream &is, BSTFileHeader &header) {
+    if (!is.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        throw BSTFileException("truncated file header");
+    }
+}
+
+void BSTFile::writeHeader(std::ostream &os, const BSTFileHeader &header) {
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}